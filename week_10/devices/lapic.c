@@ -0,0 +1,188 @@
+#include "devices/lapic.h"
+#include <debug.h>
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* Local APIC.
+
+   Every CPU has a local APIC with its own timer.  Its registers
+   are memory-mapped at the physical address in the
+   IA32_APIC_BASE MSR, normally 0xfee00000.  We map that page
+   uncached into the kernel address space and use the timer in
+   one-shot mode: writing the initial count register starts a
+   countdown at the bus clock divided by LAPIC_DIVIDE, and the
+   timer interrupt fires once when it reaches zero.
+
+   The 8259A PICs keep delivering device interrupts through the
+   local APIC's LINT0 pin, as the BIOS set it up. */
+
+#define IA32_APIC_BASE 0x1b             /* MSR holding the base address. */
+#define APIC_BASE_ENABLE (1 << 11)      /* Global enable bit in the MSR. */
+#define CPUID_APIC (1 << 9)             /* CPUID.1:EDX bit for a local APIC. */
+
+/* Register offsets, in bytes. */
+#define REG_ID      0x020               /* Local APIC ID. */
+#define REG_EOI     0x0b0               /* End of interrupt. */
+#define REG_SVR     0x0f0               /* Spurious interrupt vector. */
+#define REG_ICR_LO  0x300               /* Interrupt command, low half. */
+#define REG_ICR_HI  0x310               /* Interrupt command, high half. */
+#define REG_TIMER   0x320               /* LVT timer. */
+#define REG_TICR    0x380               /* Timer initial count. */
+#define REG_TCCR    0x390               /* Timer current count. */
+#define REG_TDCR    0x3e0               /* Timer divide configuration. */
+
+#define SVR_ENABLE  (1 << 8)            /* APIC software enable. */
+#define LVT_MASKED  (1 << 16)           /* Interrupt masked. */
+#define LVT_PERIODIC (1 << 17)          /* Timer reloads at zero. */
+#define TDCR_DIV16  0x3                 /* Divide the bus clock by 16. */
+#define ICR_INIT    0x00000500          /* INIT IPI. */
+#define ICR_FIXED   0x00000000          /* Interrupt on a vector. */
+#define ICR_STARTUP 0x00000600          /* Startup IPI. */
+#define ICR_ASSERT  0x00004000          /* Level assert. */
+#define ICR_PENDING 0x00001000          /* Delivery status: not yet accepted. */
+
+static volatile uint32_t *lapic;
+
+static uint32_t
+lapic_read (int reg) {
+	return lapic[reg / 4];
+}
+
+static void
+lapic_write (int reg, uint32_t value) {
+	lapic[reg / 4] = value;
+	/* Read back ID to wait for the write to complete. */
+	(void) lapic[REG_ID / 4];
+}
+
+/* Maps and enables the local APIC with its timer stopped.
+   Returns false if the CPU has none. */
+bool
+lapic_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+	uint64_t pa, *pte;
+
+	if (lapic != NULL)
+		return true;
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if (!(edx & CPUID_APIC))
+		return false;
+
+	pa = read_msr (IA32_APIC_BASE) & ~(uint64_t) PGMASK & 0xffffffffffULL;
+	write_msr (IA32_APIC_BASE, pa | APIC_BASE_ENABLE);
+
+	pte = pml4e_walk (base_pml4, (uint64_t) ptov (pa), 1);
+	if (pte == NULL)
+		return false;
+	*pte = pa | PTE_P | PTE_W | PTE_PCD | PTE_PWT;
+	invlpg ((uint64_t) ptov (pa));
+	lapic = ptov (pa);
+	lapic_enable ();
+	return true;
+}
+
+/* Enables the running CPU's local APIC with its timer stopped.
+   lapic_init() does this for the BSP; each application processor
+   does it for itself.  All CPUs see their own local APIC at the
+   same address. */
+void
+lapic_enable (void) {
+	ASSERT (lapic != NULL);
+
+	lapic_write (REG_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VEC);
+	lapic_write (REG_TDCR, TDCR_DIV16);
+	lapic_write (REG_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+	lapic_write (REG_TICR, 0);
+}
+
+/* Returns the running CPU's local APIC ID. */
+uint8_t
+lapic_id (void) {
+	return lapic_read (REG_ID) >> 24;
+}
+
+/* Returns true if lapic_init() succeeded. */
+bool
+lapic_present (void) {
+	return lapic != NULL;
+}
+
+/* Acknowledges the interrupt being handled. */
+void
+lapic_eoi (void) {
+	lapic_write (REG_EOI, 0);
+}
+
+/* Interrupts once, on LAPIC_TIMER_VEC, after COUNT timer ticks.
+   Replaces any countdown in progress.  COUNT must be nonzero. */
+void
+lapic_timer_oneshot (uint32_t count) {
+	ASSERT (count != 0);
+	lapic_write (REG_TIMER, LAPIC_TIMER_VEC);
+	lapic_write (REG_TICR, count);
+}
+
+/* Interrupts on LAPIC_TIMER_VEC every COUNT timer ticks.
+   Application processors use this for their scheduler tick. */
+void
+lapic_timer_periodic (uint32_t count) {
+	ASSERT (count != 0);
+	lapic_write (REG_TIMER, LVT_PERIODIC | LAPIC_TIMER_VEC);
+	lapic_write (REG_TICR, count);
+}
+
+/* Starts counting down from COUNT without interrupting, for
+   measuring the timer's frequency. */
+void
+lapic_timer_start_masked (uint32_t count) {
+	lapic_write (REG_TIMER, LVT_MASKED | LAPIC_TIMER_VEC);
+	lapic_write (REG_TICR, count);
+}
+
+/* Returns the remaining count of the current countdown. */
+uint32_t
+lapic_timer_count (void) {
+	return lapic_read (REG_TCCR);
+}
+
+/* Sends interrupt command ICR to the CPU whose local APIC ID is
+   APIC_ID and waits until its local APIC has accepted it.
+   Interrupts are turned off so that a handler cannot send an IPI
+   of its own between the two halves of the command. */
+static void
+send_ipi (uint8_t apic_id, uint32_t icr) {
+	enum intr_level old_level = intr_disable ();
+
+	lapic_write (REG_ICR_HI, (uint32_t) apic_id << 24);
+	lapic_write (REG_ICR_LO, icr);
+	while (lapic_read (REG_ICR_LO) & ICR_PENDING)
+		asm volatile ("pause");
+	intr_set_level (old_level);
+}
+
+/* Interrupts the CPU with APIC_ID on vector VEC, one of the
+   LAPIC_*_VEC vectors. */
+void
+lapic_send_ipi (uint8_t apic_id, uint8_t vec) {
+	send_ipi (apic_id, ICR_FIXED | vec);
+}
+
+/* Sends an INIT IPI, which resets the CPU with APIC_ID and
+   leaves it waiting for a startup IPI. */
+void
+lapic_send_init (uint8_t apic_id) {
+	send_ipi (apic_id, ICR_INIT | ICR_ASSERT);
+}
+
+/* Sends a startup IPI, which starts the CPU with APIC_ID in real
+   mode at physical address PA.  PA must be page aligned and
+   below 1 MB. */
+void
+lapic_send_startup (uint8_t apic_id, uint64_t pa) {
+	ASSERT (pa % PGSIZE == 0 && pa < 0x100000);
+	send_ipi (apic_id, ICR_STARTUP | (pa >> 12));
+}
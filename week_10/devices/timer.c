@@ -1,12 +1,16 @@
 #include "devices/timer.h"
 #include <debug.h>
+#include <heap.h>
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/lapic.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
+#include "intrinsic.h"
 
 /* See [8254] for hardware details of the 8254 timer chip. */
 
@@ -25,10 +29,59 @@ static int64_t ticks;
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
+/* Number of timer interrupts taken. */
+static int64_t intr_cnt;
+
+/* One-shot local APIC timer, set up by timer_lapic_init().
+
+   Boot starts with the PIT interrupting TIMER_FREQ times per
+   second.  timer_lapic_init() measures the TSC and the APIC
+   timer against it, masks the PIT and from then on programs the
+   APIC timer for each event separately.  `ticks' keeps counting
+   in TIMER_FREQ units, derived from the TSC, so everything built
+   on timer_ticks() is unchanged.
+
+   While a thread runs, the next event is the next tick, which
+   drives time slices and statistics.  While the CPU is idle the
+   tick stops: the next event is the tick at which the first
+   sleeper wakes up.  Sleeps shorter than a tick block until an
+   event at their exact TSC deadline instead of spinning.
+
+   Only the BSP keeps this timer.  Application processors run
+   their APIC timer periodically at TIMER_FREQ just to drive their
+   own time slices (timer_init_ap()); with more than one CPU the
+   BSP's tick never stops, since another CPU may put a thread to
+   sleep while the BSP is halted. */
+static bool lapic_timer;        /* Using the APIC timer? */
+static uint64_t tsc_hz;         /* TSC cycles per second. */
+static uint64_t tsc_per_tick;   /* TSC cycles per timer tick. */
+static uint64_t lapic_per_tsc;  /* APIC timer counts per TSC cycle, 32.32 fixed point. */
+static uint64_t next_tick_tsc;  /* TSC value at which `ticks' next advances. */
+static bool idle_stopped;       /* Tick stopped by timer_idle_enter()? */
+
+/* Number of PIT ticks to measure the TSC and APIC timer over. */
+#define CALIBRATE_TICKS 10
+
+/* A thread blocked in a sub-tick sleep. */
+struct hr_sleeper {
+	struct heap_elem elem;      /* hr_sleepers element. */
+	uint64_t deadline;          /* TSC value to wake up at. */
+	struct semaphore sema;      /* Upped at the deadline. */
+};
+
+/* Sub-tick sleepers, earliest deadline first. */
+static struct heap hr_sleepers;
+
 static intr_handler_func timer_interrupt;
+static intr_handler_func lapic_timer_interrupt;
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
+static uint32_t tsc_to_count (uint64_t delta);
+static void timer_program (bool idle);
+static void hr_sleep (int64_t ns);
+static void hr_wake (uint64_t now);
+static heap_less_func hr_less;
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
    interrupt PIT_FREQ times per second, and registers the
@@ -73,6 +126,108 @@ timer_calibrate (void) {
 	printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
 }
 
+/* Switches from the periodic PIT to the one-shot local APIC
+   timer, if the CPU has a local APIC.  Must be called with
+   interrupts on, after timer_calibrate(). */
+void
+timer_lapic_init (void) {
+	uint64_t tsc_start, tsc_cnt, lapic_cnt;
+	enum intr_level old_level;
+	int64_t start;
+
+	ASSERT (intr_get_level () == INTR_ON);
+	if (!lapic_init ())
+		return;
+
+	/* Count TSC cycles and APIC timer counts over
+	   CALIBRATE_TICKS PIT ticks, starting on a tick edge. */
+	start = ticks;
+	while (ticks == start)
+		barrier ();
+	start = ticks;
+	tsc_start = rdtsc ();
+	lapic_timer_start_masked (UINT32_MAX);
+	while (ticks - start < CALIBRATE_TICKS)
+		barrier ();
+	tsc_cnt = rdtsc () - tsc_start;
+	lapic_cnt = UINT32_MAX - lapic_timer_count ();
+	if (tsc_cnt == 0 || lapic_cnt == 0)
+		return;
+
+	tsc_hz = tsc_cnt * TIMER_FREQ / CALIBRATE_TICKS;
+	tsc_per_tick = tsc_cnt / CALIBRATE_TICKS;
+	lapic_per_tsc = (lapic_cnt << 32) / tsc_cnt;
+	heap_init (&hr_sleepers, hr_less, NULL);
+	intr_register_ext (LAPIC_TIMER_VEC, lapic_timer_interrupt, "Local APIC Timer");
+
+	old_level = intr_disable ();
+	outb (0x21, inb (0x21) | 0x01);    /* Mask IRQ 0, the PIT, on the master PIC. */
+	next_tick_tsc = rdtsc () + tsc_per_tick;
+	lapic_timer = true;
+	timer_program (false);
+	intr_set_level (old_level);
+
+	printf ("Local APIC timer: %'"PRIu64" Hz, TSC %'"PRIu64" Hz.\n",
+			lapic_cnt * TIMER_FREQ / CALIBRATE_TICKS, tsc_hz);
+}
+
+/* Called by the idle thread, with interrupts off, just before
+   it halts.  Stops the tick until the first sleeper is due.
+   The MLFQS keeps ticking, because it samples the run queue
+   once a second. */
+void
+timer_idle_enter (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!lapic_timer || thread_mlfqs || cpu_cnt > 1)
+		return;
+	idle_stopped = true;
+	timer_program (true);
+}
+
+/* Returns true if timer_lapic_init() switched to the APIC
+   timer. */
+bool
+timer_lapic_active (void) {
+	return lapic_timer;
+}
+
+/* Starts the running application processor's APIC timer,
+   interrupting TIMER_FREQ times per second.  Only the BSP
+   advances `ticks' and wakes sleepers; see
+   lapic_timer_interrupt(). */
+void
+timer_init_ap (void) {
+	ASSERT (lapic_timer);
+	lapic_timer_periodic (tsc_to_count (tsc_per_tick));
+}
+
+/* Called by the idle thread, with interrupts off, when an
+   interrupt has woken it up.  Counts the ticks that passed
+   without an interrupt as idle time and restarts the tick. */
+void
+timer_idle_exit (void) {
+	uint64_t now;
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (!idle_stopped)
+		return;
+	idle_stopped = false;
+
+	now = rdtsc ();
+	if (now >= next_tick_tsc) {
+		int64_t skipped = (now - next_tick_tsc) / tsc_per_tick + 1;
+
+		ticks += skipped;
+		next_tick_tsc += skipped * tsc_per_tick;
+		thread_idle_ticks (skipped);
+		if (ticks >= next_thread_to_awake)
+			thread_awake (ticks);
+	}
+	timer_program (false);
+}
+
 /* Returns the number of timer ticks since the OS booted. */
 /* OS 부팅 이후 타이머 틱 수를 반환합니다. */
 int64_t
@@ -131,7 +286,8 @@ timer_nsleep (int64_t ns) {
 /* 타이머 통계를 출력합니다. */
 void
 timer_print_stats (void) {
-	printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
+	printf ("Timer: %"PRId64" ticks, %"PRId64" interrupts\n",
+			timer_ticks (), intr_cnt);
 }
 
 /* Timer interrupt handler. */
@@ -140,9 +296,11 @@ timer_print_stats (void) {
 즉 일정 시간 마다 자동으로 scheduling이 발생*/
 static void
 timer_interrupt (struct intr_frame *args UNUSED) {
+	intr_cnt++;
 	ticks++;
 	thread_tick (); //sleep queue에서 깨어날 thread가 있는 확인
-	thread_awake (ticks);//ticks가 증가 할때 마다 확인해서 깨우기
+	if (ticks >= next_thread_to_awake)
+		thread_awake (ticks);//깨어날 스레드가 있는 tick에만 깨우기
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -196,6 +354,10 @@ real_time_sleep (int64_t num, int32_t denom) {
 		   timer_sleep() because it will yield the CPU to other
 		   processes. */
 		timer_sleep (ticks);
+	} else if (lapic_timer && num > 0) {
+		/* Block until an APIC timer event at the deadline. */
+		ASSERT (denom % 1000 == 0);
+		hr_sleep (num * (1000 * 1000 * 1000 / denom));
 	} else {
 		/* Otherwise, use a busy-wait loop for more accurate
 		   sub-tick timing.  We scale the numerator and denominator
@@ -204,3 +366,114 @@ real_time_sleep (int64_t num, int32_t denom) {
 		busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000));
 	}
 }
+
+/* Local APIC timer interrupt handler.  Advances `ticks' past
+   every tick boundary that has gone by, usually one, wakes up
+   sleepers that are due and programs the next event. */
+static void
+lapic_timer_interrupt (struct intr_frame *args UNUSED) {
+	uint64_t now = rdtsc ();
+
+	intr_cnt++;
+	if (cpu_current ()->id != 0) {
+		thread_tick ();
+		return;
+	}
+	while (now >= next_tick_tsc) {
+		ticks++;
+		next_tick_tsc += tsc_per_tick;
+		thread_tick ();
+		if (ticks >= next_thread_to_awake)
+			thread_awake (ticks);
+	}
+	hr_wake (now);
+	timer_program (false);
+}
+
+/* Converts DELTA TSC cycles into APIC timer counts, clamped to
+   what the initial count register holds. */
+static uint32_t
+tsc_to_count (uint64_t delta) {
+	uint64_t count;
+
+	if (delta > (1ULL << 40))
+		delta = 1ULL << 40;
+	count = (delta >> 32) * lapic_per_tsc
+		+ (((delta & 0xffffffff) * lapic_per_tsc) >> 32);
+	if (count == 0)
+		return 1;
+	return count > UINT32_MAX ? UINT32_MAX : count;
+}
+
+/* Programs the APIC timer for the next event: the next tick, or
+   if IDLE the tick at which the first sleeper wakes up, or a
+   sub-tick sleeper's deadline if that comes first.  Interrupts
+   must be off. */
+static void
+timer_program (bool idle) {
+	uint64_t now = rdtsc ();
+	uint64_t deadline = next_tick_tsc;
+
+	if (idle) {
+		int64_t wait = next_thread_to_awake - ticks - 1;
+
+		if (next_thread_to_awake == INT64_MAX)
+			deadline = UINT64_MAX;
+		else if (wait > 0)
+			deadline += (wait < 60 * TIMER_FREQ ? wait : 60 * TIMER_FREQ) * tsc_per_tick;
+	}
+	if (!heap_empty (&hr_sleepers)) {
+		struct hr_sleeper *s = heap_entry (heap_min (&hr_sleepers),
+				struct hr_sleeper, elem);
+
+		if (s->deadline < deadline)
+			deadline = s->deadline;
+	}
+	lapic_timer_oneshot (tsc_to_count (deadline > now ? deadline - now : 0));
+}
+
+/* Blocks the current thread for about NS nanoseconds, which
+   should be less than a tick, using the APIC timer. */
+static void
+hr_sleep (int64_t ns) {
+	struct hr_sleeper s;
+	enum intr_level old_level;
+
+	sema_init (&s.sema, 0);
+	old_level = intr_disable ();
+	s.deadline = rdtsc () + ns * (tsc_hz / 1000) / (1000 * 1000);
+	heap_push (&hr_sleepers, &s.elem);
+	if (heap_min (&hr_sleepers) == &s.elem) {
+		if (cpu_current ()->id == 0)
+			timer_program (false);
+		else
+			/* Only the BSP's timer wakes sleepers: make it
+			   reprogram. */
+			lapic_send_ipi (cpus[0].apic_id, LAPIC_TIMER_VEC);
+	}
+	intr_set_level (old_level);
+
+	sema_down (&s.sema);
+}
+
+/* Wakes up the sub-tick sleepers whose deadline is at or before
+   NOW. */
+static void
+hr_wake (uint64_t now) {
+	while (!heap_empty (&hr_sleepers)) {
+		struct hr_sleeper *s = heap_entry (heap_min (&hr_sleepers),
+				struct hr_sleeper, elem);
+
+		if (s->deadline > now)
+			break;
+		heap_pop (&hr_sleepers);
+		sema_up (&s->sema);
+	}
+}
+
+static bool
+hr_less (const struct heap_elem *a, const struct heap_elem *b,
+		void *aux UNUSED) {
+	return heap_entry (a, struct hr_sleeper, elem)->deadline
+		< heap_entry (b, struct hr_sleeper, elem)->deadline;
+}
@@ -0,0 +1,30 @@
+#ifndef DEVICES_LAPIC_H
+#define DEVICES_LAPIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Interrupt vectors delivered by the local APIC.
+   0x20...0x2f belong to the 8259A PICs; 0x30...0x3f are local
+   APIC interrupts, which are acknowledged with lapic_eoi(). */
+#define LAPIC_TIMER_VEC 0x30
+#define LAPIC_RESCHED_VEC 0x31          /* Run the scheduler (threads/thread.c). */
+#define LAPIC_TLB_VEC 0x32              /* TLB shootdown (threads/mmu.c). */
+#define LAPIC_SPURIOUS_VEC 0xff
+
+bool lapic_init (void);
+bool lapic_present (void);
+void lapic_enable (void);
+uint8_t lapic_id (void);
+void lapic_eoi (void);
+
+void lapic_send_init (uint8_t apic_id);
+void lapic_send_startup (uint8_t apic_id, uint64_t pa);
+void lapic_send_ipi (uint8_t apic_id, uint8_t vec);
+
+void lapic_timer_oneshot (uint32_t count);
+void lapic_timer_periodic (uint32_t count);
+void lapic_timer_start_masked (uint32_t count);
+uint32_t lapic_timer_count (void);
+
+#endif /* devices/lapic.h */
@@ -2,6 +2,7 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Number of timer interrupts per second. */
@@ -9,6 +10,11 @@
 
 void timer_init (void);
 void timer_calibrate (void);
+void timer_lapic_init (void);
+bool timer_lapic_active (void);
+void timer_init_ap (void);
+void timer_idle_enter (void);
+void timer_idle_exit (void);
 
 int64_t timer_ticks (void);
 int64_t timer_elapsed (int64_t);
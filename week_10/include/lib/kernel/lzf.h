@@ -0,0 +1,19 @@
+#ifndef __LIB_KERNEL_LZF_H
+#define __LIB_KERNEL_LZF_H
+
+#include <stddef.h>
+
+/* LZF-style compression.
+
+   A small LZ77 codec that favours speed over ratio.  The output
+   is a sequence of literal runs and back references into the
+   last 8 kB of output, so it works well on memory pages that
+   contain repeated words, zero runs and text.
+
+   Compression keeps its hash table in static storage, so
+   callers must serialize calls to lzf_compress(). */
+
+size_t lzf_compress (const void *in, size_t in_len, void *out, size_t out_len);
+size_t lzf_decompress (const void *in, size_t in_len, void *out, size_t out_len);
+
+#endif /* lib/kernel/lzf.h */
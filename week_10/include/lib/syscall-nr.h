@@ -36,6 +36,24 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Virtual memory extensions. */
+	SYS_MADVISE,                /* Advise on a range's access pattern. */
+	SYS_MSYNC,                  /* Write a mapping's dirty pages back. */
+	SYS_BRK,                    /* Move the program break. */
 };
 
+/* Advice values for SYS_MADVISE. */
+#define MADV_NORMAL     0       /* No special treatment. */
+#define MADV_RANDOM     1       /* Expect random access: read one page per fault. */
+#define MADV_SEQUENTIAL 2       /* Expect sequential access: read ahead, drop behind. */
+#define MADV_WILLNEED   3       /* Will be used soon: read in the background. */
+#define MADV_DONTNEED   4       /* Not needed now: free frames and swap slots. */
+
+/* Flags for SYS_MMAP, or'd into the WRITABLE argument. */
+#define MAP_POPULATE    0x10    /* Read the mapping in now, not on first access. */
+#define MAP_ANONYMOUS   0x20    /* Zero-filled memory; FD and OFFSET are ignored. */
+#define MAP_AROUND_SHIFT 8
+#define MAP_AROUND(N)   ((N) << MAP_AROUND_SHIFT)  /* Read up to N pages (1-16) per fault. */
+
 #endif /* lib/syscall-nr.h */
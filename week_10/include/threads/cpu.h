@@ -0,0 +1,77 @@
+#ifndef THREADS_CPU_H
+#define THREADS_CPU_H
+
+/* Physical address the application processors start at.  It
+   must be page aligned and below 1 MB; the low megabyte is
+   never handed out by the page allocator. */
+#define AP_TRAMPOLINE 0x8000
+
+/* Offsets in struct cpu used from assembly (syscall-entry.S). */
+#define CPU_TSS 8
+#define CPU_SCRATCH 16
+
+#ifndef __ASSEMBLER__
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/runq.h"
+
+/* Most CPUs we will bring up. */
+#define CPU_MAX 16
+
+struct task_state;
+
+/* Per-CPU data.
+
+   Each CPU's GS base points to its own struct cpu, so
+   cpu_current() is a single load from %gs:0.  The BSP sets it up
+   in cpu_init_bsp(), before anything else uses it; application
+   processors do it in ap_main() (threads/cpu.c).  User mode runs
+   with its own GS base: the kernel entry and exit paths switch
+   between the two with swapgs.
+
+   Every CPU has its own run queue, which threads it wakes up
+   join.  Its scheduler runs the highest priority thread in any
+   CPU's queue, preferring its own on a tie (threads/thread.c).
+   Kernel code that runs with interrupts off holds the interrupt
+   lock (threads/interrupt.c), which is what keeps the run
+   queues, semaphores and other data protected by intr_disable()
+   consistent between CPUs. */
+struct cpu {
+	struct cpu *self;           /* This structure, at %gs:0. */
+	struct task_state *tss;     /* TSS (userprog/tss.c), at CPU_TSS. */
+	uint64_t scratch[2];        /* Saved by syscall_entry, at CPU_SCRATCH. */
+	int id;                     /* Index in cpus[]; the BSP is 0. */
+	uint8_t apic_id;            /* Local APIC ID. */
+	volatile bool started;      /* Reached ap_main()? */
+
+	/* Scheduler (threads/thread.c). */
+	struct runq runq;           /* Threads ready to run here. */
+	struct thread *idle_thread; /* Runs when no thread is ready. */
+	struct thread *curr;        /* Running thread. */
+	unsigned slice_ticks;       /* Timer ticks since the last switch. */
+
+	/* Interrupt state (threads/interrupt.c). */
+	bool in_external_intr;      /* Processing an external interrupt? */
+	bool yield_on_return;       /* Yield on interrupt return? */
+
+	/* Address space (threads/mmu.c). */
+	uint64_t *pml4;             /* Active page table. */
+	bool pcid0_dirty;           /* User entries loaded under PCID 0. */
+};
+
+extern struct cpu cpus[CPU_MAX];
+extern int cpu_cnt;
+
+/* Returns the running CPU's struct cpu. */
+static inline struct cpu *
+cpu_current (void) {
+	struct cpu *c;
+	asm volatile ("movq %%gs:0, %0" : "=r" (c));
+	return c;
+}
+
+void cpu_init_bsp (void);
+void smp_init (void);
+#endif /* __ASSEMBLER__ */
+
+#endif /* threads/cpu.h */
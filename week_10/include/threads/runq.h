@@ -0,0 +1,36 @@
+#ifndef THREADS_RUNQ_H
+#define THREADS_RUNQ_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/thread.h"
+
+/* Priority run queue.
+
+   One FIFO list of threads for each priority PRI_MIN...PRI_MAX
+   and a bitmap with bit P set when the list for priority P is
+   not empty.  Inserting, removing and finding the highest
+   priority thread all take constant time, however many threads
+   are queued.
+
+   A queued thread is kept in the list for its priority at the
+   time it was pushed, so its priority may only change while it
+   is not in a run queue: remove it, change it and push it
+   again.  A queued thread's `runq' member names its queue. */
+struct runq {
+	uint64_t ready_mask;                  /* Bit P: lists[P] not empty. */
+	struct list lists[PRI_MAX + 1];       /* Threads by priority. */
+	size_t size;                          /* Number of queued threads. */
+};
+
+void runq_init (struct runq *);
+void runq_push (struct runq *, struct thread *);
+void runq_remove (struct runq *, struct thread *);
+struct thread *runq_pop (struct runq *);
+int runq_max_priority (const struct runq *);
+bool runq_empty (const struct runq *);
+size_t runq_size (const struct runq *);
+
+#endif /* threads/runq.h */
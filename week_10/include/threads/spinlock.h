@@ -0,0 +1,24 @@
+#ifndef THREADS_SPINLOCK_H
+#define THREADS_SPINLOCK_H
+
+#include <stdbool.h>
+
+/* Spinlock.
+
+   Protects data that more than one CPU may touch.  Unlike struct
+   lock it never sleeps, so it may be used where a thread cannot
+   block: in interrupt handlers and in the scheduler.  The caller
+   must have interrupts off, so that an interrupt handler on the
+   same CPU cannot spin on a lock that CPU already holds. */
+struct spinlock {
+	volatile int locked;        /* 1 while held. */
+	struct cpu *holder;         /* CPU holding it (for debugging). */
+};
+
+void spinlock_init (struct spinlock *);
+void spinlock_acquire (struct spinlock *);
+bool spinlock_try_acquire (struct spinlock *);
+void spinlock_release (struct spinlock *);
+bool spinlock_held_by_current_cpu (const struct spinlock *);
+
+#endif /* threads/spinlock.h */
@@ -2,8 +2,10 @@
 #define THREADS_THREAD_H
 
 #include <debug.h>
+#include <heap.h>
 #include <list.h>
 #include <stdint.h>
+#include "threads/fixed-point.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #ifdef VM
@@ -33,6 +35,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread niceness (MLFQS). */
+#define NICE_MIN -20                    /* Nicest to other threads. */
+#define NICE_DEFAULT 0                  /* Default niceness. */
+#define NICE_MAX 20                     /* Least nice. */
+
 /*project2: sysem call*/
 #define FDT_PAGES 3
 #define MAX_FD_NUM	(1<<9)
@@ -100,9 +107,16 @@ struct thread {
 	
 	/*잠잔 노드가 일어날 시간*/
 	int64_t wakeup_time;				
+	struct heap_elem sleep_elem;		//sleep_heap의 elem
+
+	/* MLFQS (thread_mlfqs일 때만 쓴다) */
+	int nice;							/* 다른 스레드에게 양보하는 정도 */
+	fixed_t recent_cpu;					/* 최근에 CPU를 쓴 양 (감쇠하는 tick 수) */
+	struct list_elem all_elem;			/* all_list의 elem */
 
 	/* Shared between thread.c and synch.c. */
 	struct list_elem elem;              /* List element. */
+	struct runq *runq;					/* READY일 때 들어 있는 실행 대기열 (threads/runq.c) */
 
 	/*donation 관련*/
 	int init_priority;
@@ -140,6 +154,9 @@ struct thread {
 	struct supplemental_page_table spt;
 	void *stack_bottom;
 	void *rsp_stack;
+	void *heap_start;	/* 힙이 시작하는 주소 (실행 파일 세그먼트 바로 뒤 페이지) */
+	void *brk;			/* 현재 프로그램 break. 힙은 [heap_start, brk) */
+	bool in_syscall;	/* 시스템 콜이나 exec 중이면 true (커널이 유저 메모리에 직접 쓴다) */
 #endif
 	/* Owned by thread.c. */
 	struct intr_frame tf;               /* Information for switching */
@@ -153,12 +170,16 @@ extern bool thread_mlfqs;
 
 void thread_sleep(int64_t ticks); 		//실행중인 스레드를 슬립으로 만듬
 void thread_awake (int64_t ticks);		//슬립큐에서 캐워야할 스레드를 깨움
+extern int64_t next_thread_to_awake;	//가장 먼저 깨어날 스레드의 wakeup_time
 
 void thread_init (void);
 void thread_start (void);
+void thread_init_ap (void);
+void thread_start_ap (void) NO_RETURN;
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_idle_ticks (int64_t n);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
@@ -26,6 +26,10 @@ struct container {
     off_t offset;           //해당 파일의 오프셋
     size_t page_read_bytes; //읽어올 파일의 데이터 크기
     size_t page_zero_bytes; //읽어올 파일의 데이터 크기
+    size_t window;          //매핑이 정한 fault-around 페이지 수 (MADV_NORMAL이 되돌리는 값)
+    size_t around;          //폴트 한 번에 함께 읽어 올 페이지 수 (매핑마다 따로)
+    bool shared;            //읽기 전용 실행 파일 페이지: 다른 프로세스와 프레임을 공유
+    bool drop_behind;       //순차 접근(MADV_SEQUENTIAL): 지나간 페이지를 바로 내보낸다
 };
 
 #endif /* userprog/process.h */
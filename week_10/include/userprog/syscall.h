@@ -4,6 +4,7 @@
 #include "threads/synch.h"
 
 void syscall_init (void);
+void syscall_init_cpu (void);
 
 
 struct lock filesys_lock;
@@ -2,6 +2,7 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct frame;
 enum vm_type;
 
 struct anon_page {
@@ -10,5 +11,12 @@ struct anon_page {
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_swap_ref (struct page *page);
+int anon_swap_clean (struct frame *frame);
+void anon_swap_forget (struct frame *frame);
+void anon_print_stats (void);
+int anon_slot_alloc (struct thread *owner);
+void anon_slot_release (int slot);
+long long anon_slot_probes (void);
 
 #endif
@@ -0,0 +1,35 @@
+#ifndef VM_EVICT_H
+#define VM_EVICT_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct frame;
+struct page;
+
+/* 페이지 교체 정책.
+   page_operations처럼 함수 테이블로 만들어 두고
+   커널 명령줄(-vmpolicy=NAME)로 하나를 고른다.
+   모든 함수는 frame_lock을 잡은 상태에서 불린다. */
+struct evict_policy {
+	const char *name;
+	void (*init) (struct frame *table, size_t cnt);
+	/* FRAME에 페이지가 새로 들어왔다. (frame->page가 설정된 뒤) */
+	void (*insert) (struct frame *frame);
+	/* FRAME이 쫓겨나지 않고 해제되었다. */
+	void (*remove) (struct frame *frame);
+	/* 쫓아낼 프레임을 골라 정책의 목록에서 뺀 뒤 돌려준다. */
+	struct frame *(*get_victim) (void);
+	/* PAGE가 없어진다. 정책이 기억하던 이력(ghost)을 지운다. */
+	void (*forget) (struct page *page);
+};
+
+bool evict_policy_select (const char *name);
+void evict_init (struct frame *table, size_t cnt);
+void evict_insert (struct frame *frame);
+void evict_remove (struct frame *frame);
+struct frame *evict_get_victim (void);
+void evict_cancel (struct frame *frame);
+void evict_forget (struct page *page);
+void evict_print_stats (void);
+
+#endif /* VM_EVICT_H */
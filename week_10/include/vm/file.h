@@ -19,9 +19,43 @@ struct lazy_load_info{
 	off_t offset
 };
 
+/* 폴트 한 번에 파일에서 함께 읽어 올 페이지 수의 기본값.
+   새 매핑(ELF 세그먼트, mmap)은 이 값을 받아 가고, 1이면 fault-around를 하지 않는다.
+   -faround=N으로 바꿀 수 있고, mmap은 MAP_AROUND(N)으로 매핑마다 따로 정할 수 있다. */
+#define FAULT_AROUND_MAX 16
+extern size_t file_fault_around;
+
+struct container;
+struct supplemental_page_table;
+
+/* mmap으로 만든 영역 하나. 주소 구간 [start, end)가 파일의 offset부터에 대응한다.
+   페이지는 폴트가 날 때 하나씩 만들어지므로 mmap/munmap 비용은 영역 크기와 상관없다. */
+struct vma {
+	struct list_elem elem;	/* spt->vmas의 elem */
+	void *start;			/* 시작 주소 (페이지 정렬) */
+	void *end;				/* 끝 주소 (페이지 정렬, 포함하지 않음) */
+	struct file *file;		/* 이 영역만 쓰는 (다시 연) 파일 */
+	off_t offset;			/* start에 대응하는 파일 오프셋 */
+	size_t read_bytes;		/* 파일에서 읽는 바이트 수. 나머지는 0으로 채운다 */
+	bool writable;
+	size_t window;			/* mmap에서 정한 fault-around 페이지 수 (MADV_NORMAL이 되돌리는 값) */
+	size_t around;			/* 지금 쓰는 fault-around 페이지 수 */
+	bool drop_behind;		/* MADV_SEQUENTIAL: 지나간 페이지를 바로 내보낸다 */
+};
+
 void vm_file_init (void);
+bool file_read_around (struct page *page, void *kva, struct container *aux);
+void file_print_stats (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
+bool do_brk (void *addr);
+bool do_msync (void *addr, size_t length);
+struct vma *vma_find (struct supplemental_page_table *spt, void *va);
+struct page *vma_fault_page (struct supplemental_page_table *spt, void *va);
+bool vma_page_copy (struct supplemental_page_table *dst, struct page *page);
+bool vma_copy (struct supplemental_page_table *dst, struct supplemental_page_table *src);
+void vma_kill (struct supplemental_page_table *spt);
+void vma_advise (struct supplemental_page_table *spt, void *start, void *end, int advice);
 #endif
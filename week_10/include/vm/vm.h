@@ -41,8 +41,18 @@ enum vm_type {
 
 struct page_operations;
 struct thread;
-struct list frame_table;
-struct list_elem *start;
+
+/* 백그라운드 회수 워터마크 (빈 프레임 수). */
+extern size_t vm_reclaim_low;
+extern size_t vm_reclaim_high;
+/* ksmd가 한 번에 살펴볼 프레임 수 (-ksm=N). 0이면 같은 페이지 합치기를 하지 않는다. */
+extern size_t vm_ksm_pages;
+/* flushd가 더티 mmap 페이지를 파일에 쓰는 주기 (tick, -flush=N). 0이면 하지 않는다. */
+extern size_t vm_flush_interval;
+/* exec할 때 세그먼트를 폴트를 기다리지 않고 바로 읽어 매핑한다 (-populate). */
+extern bool vm_populate_exec;
+/* 익명 영역의 2 MB 구간을 2 MB 페이지 하나로 매핑한다 (-nohuge로 끈다). */
+extern bool vm_huge_pages;
 
 
 #define VM_TYPE(type) ((type) & 7)
@@ -59,8 +69,12 @@ struct page {
 	struct frame *frame;   //물리 메모리 프레임 주소
 
 	/* Your implementation */
-	struct hash_elem hash_elem;
 	bool writable;
+	struct thread *owner;          //이 페이지를 가진 프로세스(스레드)
+	struct list_elem share_elem;   //frame->pages에 들어가는 elem (COW 공유)
+	struct list_elem ghost_elem;   //쫓겨난 뒤 교체 정책의 이력(ghost) 큐에 들어가는 elem
+	int ghost;                     //들어 있는 이력 큐 (0이면 없음)
+	bool prefetch;                 //prefetchd가 미리 읽는 중이면 true (frame_lock이 보호)
 	// size_t page_cnt; 
 	// enum vm_type vm_type;
 
@@ -78,10 +92,31 @@ struct page {
 };
 
 /* The representation of "frame" */
+/* 프레임 테이블은 유저 풀의 물리 프레임 번호로 인덱싱하는 배열이고,
+   struct frame은 그 한 칸이다. 빈 프레임은 page == NULL. */
 struct frame {
 	void *kva;	//커널 가상 주소를 가르키는 포인터
 	struct page *page;	//프레임과 맵핑되는 프로세스 유저의 가상주소 페이지
-	struct list_elem frame_elem; //추가
+	struct list pages;	//이 프레임을 공유하는 페이지들 (fork 후 COW), page도 여기 들어있다
+	struct thread *owner;	//page의 주인. 이 스레드의 pml4에 매핑되어 있다
+	int pin_cnt;	//0보다 크면 교체 대상에서 제외 (채우는 중/복사 중)
+	bool io;	//frame_lock을 놓고 디스크에 쓰는 중 (쫓아내기, writeback). 페이지를 없애거나 공유하려면 기다린다
+	bool accessed;	//PTE에서 모아 둔 accessed 비트 (PTE를 다시 만들어도 남는다)
+	bool dirty;	//PTE에서 모아 둔 dirty 비트
+	int swap_slot;	//익명 프레임의 내용을 쫓겨나기 전에 미리 써 둔 스왑 슬롯 (없으면 -1)
+	bool clean_queued;	//미리 써 두려고 cleand의 큐에 들어 있으면 true
+	int64_t last_used;	//마지막으로 접근이 확인된 tick (LRU 상태)
+	struct list_elem lru_elem;	//교체 정책의 큐에 들어가는 elem
+	int queue;	//들어 있는 교체 정책 큐 (0이면 없음)
+	struct hash_elem text_elem;	//공유 text 프레임 표(text_frames)의 elem
+	struct inode *text_inode;	//공유 text이면 내용이 온 실행 파일 (아니면 NULL)
+	off_t text_ofs;	//그 파일 안의 오프셋
+	size_t text_bytes;	//파일에서 읽은 바이트 수 (나머지는 0)
+	struct hash_elem ksm_elem;	//같은 페이지 합치기 표(ksm_frames)의 elem
+	uint64_t ksm_sum;	//ksmd가 지난번에 계산한 내용의 해시
+	bool ksm_listed;	//ksm_frames에 들어 있으면 true
+	bool huge;	//2 MB 페이지 하나로 매핑된 프레임 512개 중 하나이면 true
+	struct list_elem huge_elem;	//블록의 첫 프레임이면 huge_frames의 elem
 };
 
 /* The function table for page operations.
@@ -109,10 +144,20 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. 
  * 현재 프로세스의 메모리 공간 표현.*/
+/* 보조 페이지 테이블. 가상 페이지 번호(VPN)를 키로 하는 radix tree이다.
+   x86-64 페이지 테이블처럼 9비트씩 4단계로 나누고, 노드 하나는 512칸짜리 페이지 하나다.
+   코드·데이터·스택처럼 빽빽하게 모인 영역은 몇 개의 노드로 다 표현되고,
+   찾을 때는 메모리 할당 없이 포인터를 네 번 따라가면 된다.
+   마지막으로 찾은 잎(leaf) 노드를 기억해 두어 같은 2MB 안을 다시 찾으면 바로 돌려준다.
+   노드는 supplemental_page_table_kill() 때만 해제한다.
+   mmap한 영역은 페이지별로 만들어 두지 않고 VMAS에 주소 구간(struct vma)으로만
+   기록했다가, 폴트가 나면 그 페이지만 트리에 만든다. */
 struct supplemental_page_table {
-	//뭐가 필요할까
-	struct hash hashs;
-
+	void **root;		/* 최상위 노드 (페이지가 하나도 없었으면 NULL) */
+	void **hint;		/* 마지막으로 찾은 잎 노드 */
+	uint64_t hint_key;	/* HINT가 맡은 VPN >> 9 */
+	size_t page_cnt;	/* 들어 있는 페이지 수 */
+	struct list vmas;	/* mmap 영역 (struct vma, vm/file.h) */
 };
 
 #include "threads/thread.h"
@@ -124,10 +169,20 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+struct page *spt_lookup_page (struct supplemental_page_table *spt, void *va);
+bool spt_for_each (struct supplemental_page_table *spt, void *start, void *end,
+		bool (*func) (struct page *, void *), void *aux);
 
 void vm_init (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
+bool vm_prepare_write (struct page *page);
+void vm_zero_unmap (struct page *page);
+bool vm_page_wait (struct page *page);
+bool vm_page_drop (struct page *page);
+bool do_madvise (void *addr, size_t length, int advice);
+void vm_flush_range (struct supplemental_page_table *spt, void *start, void *end);
+void vm_populate (struct supplemental_page_table *spt, void *start, void *end);
 
 #define vm_alloc_page(type, upage, writable) \
 	vm_alloc_page_with_initializer ((type), (upage), (writable), NULL, NULL)
@@ -137,12 +192,20 @@ void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
 enum vm_type page_get_type (struct page *page);
 static struct frame *vm_evict_frame(void);
-bool delete_page (struct hash *pages, struct page *p);
-unsigned page_hash (const struct hash_elem *e, void *aux);
-bool page_less (const struct hash_elem *a, 
-	const struct hash_elem *b, void *aux);
 static void vm_stack_growth (void *addr UNUSED);
 static bool setup_stack (struct intr_frame *if_);
-void spt_destructor(struct hash_elem *e, void *aux);
+void frame_detach (struct page *page);
+bool frame_writeback (struct page *page);
+struct frame *vm_frame_lookup (void *kva);
+bool frame_test_and_clear_accessed (struct frame *frame);
+bool frame_is_dirty (struct frame *frame);
+void frame_start_clean (struct frame *frame);
+struct frame *vm_get_free_frame (void);
+void vm_put_free_frame (struct frame *frame);
+bool vm_install_frame (struct page *page, struct frame *frame);
+struct container;
+bool vm_text_cached (struct container *c);
+void vm_text_register (struct frame *frame, struct container *c);
+void vm_print_stats (void);
 
 #endif  /* VM_VM_H */
@@ -0,0 +1,18 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct disk;
+
+/* 압축 스왑 캐시에 쓸 수 있는 최대 바이트 수.
+   -zswap=KB로 정하고, 0이면 끈다. 정하지 않으면 유저 풀의 1/8. */
+extern size_t zswap_limit;
+
+void zswap_init (struct disk *swap_disk, size_t slot_cnt, size_t user_pages);
+bool zswap_store (int slot, const void *kva);
+bool zswap_load (int slot, void *kva);
+void zswap_invalidate (int slot);
+void zswap_print_stats (void);
+
+#endif /* VM_ZSWAP_H */
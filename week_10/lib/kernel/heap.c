@@ -0,0 +1,107 @@
+#include "heap.h"
+#include "../debug.h"
+
+/* Links the roots A and B, either of which may be null, and
+   returns the root of the result.  The larger root becomes the
+   leftmost child of the smaller one. */
+static struct heap_elem *
+meld (struct heap *h, struct heap_elem *a, struct heap_elem *b) {
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+	if (h->less (b, a, h->aux)) {
+		struct heap_elem *t = a;
+		a = b;
+		b = t;
+	}
+	b->next = a->child;
+	a->child = b;
+	return a;
+}
+
+/* Initializes H as an empty heap ordered by LESS given auxiliary
+   data AUX. */
+void
+heap_init (struct heap *h, heap_less_func *less, void *aux) {
+	ASSERT (h != NULL);
+	ASSERT (less != NULL);
+
+	h->root = NULL;
+	h->size = 0;
+	h->less = less;
+	h->aux = aux;
+}
+
+/* Inserts E into H. */
+void
+heap_push (struct heap *h, struct heap_elem *e) {
+	ASSERT (h != NULL);
+	ASSERT (e != NULL);
+
+	e->child = e->next = NULL;
+	h->root = meld (h, h->root, e);
+	h->size++;
+}
+
+/* Returns the minimum element of H, which must not be empty. */
+struct heap_elem *
+heap_min (struct heap *h) {
+	ASSERT (!heap_empty (h));
+	return h->root;
+}
+
+/* Removes and returns the minimum element of H, which must not
+   be empty.
+
+   The children of the old root are melded in two passes: first
+   in pairs from left to right, then the pairs from right to
+   left.  This keeps the amortized cost logarithmic. */
+struct heap_elem *
+heap_pop (struct heap *h) {
+	struct heap_elem *min = heap_min (h);
+	struct heap_elem *c = min->child;
+	struct heap_elem *pairs = NULL;
+	struct heap_elem *root = NULL;
+
+	while (c != NULL) {
+		struct heap_elem *a = c;
+		struct heap_elem *b = c->next;
+		struct heap_elem *m;
+
+		if (b == NULL) {
+			a->next = pairs;
+			pairs = a;
+			break;
+		}
+		c = b->next;
+		a->next = b->next = NULL;
+		m = meld (h, a, b);
+		m->next = pairs;
+		pairs = m;
+	}
+	while (pairs != NULL) {
+		struct heap_elem *next = pairs->next;
+
+		pairs->next = NULL;
+		root = meld (h, root, pairs);
+		pairs = next;
+	}
+
+	h->root = root;
+	h->size--;
+	min->child = min->next = NULL;
+	return min;
+}
+
+/* Returns the number of elements in H. */
+size_t
+heap_size (struct heap *h) {
+	return h->size;
+}
+
+/* Returns true if H is empty, false otherwise. */
+bool
+heap_empty (struct heap *h) {
+	return h->root == NULL;
+}
@@ -0,0 +1,171 @@
+#include "lzf.h"
+#include <stdint.h>
+#include <string.h>
+
+/* Encoding.
+
+   Each token starts with a control byte CTRL.
+
+   CTRL < 32: a literal run of CTRL + 1 bytes follows.
+
+   CTRL >= 32: a back reference.  LEN = CTRL >> 5; if LEN is 7,
+   the next byte is added to it.  The next byte is the low 8 bits
+   of the offset, whose high 5 bits are CTRL & 31.  LEN + 2 bytes
+   are copied starting OFFSET + 1 bytes before the current output
+   position, which may overlap the bytes being written. */
+
+#define HASH_LOG 12                     /* Hash table has 2**HASH_LOG entries. */
+#define MAX_LIT (1 << 5)                /* Longest literal run. */
+#define MAX_OFF (1 << 13)               /* Farthest back reference. */
+#define MAX_REF ((1 << 8) + (1 << 3))   /* Longest encoded match length. */
+
+/* Most recent input position (plus 1) with each hash of three
+   bytes, or 0 if none. */
+static uint16_t htab[1 << HASH_LOG];
+
+static inline unsigned
+hash3 (const uint8_t *p)
+{
+  uint32_t v = ((uint32_t) p[0] << 16) | (p[1] << 8) | p[2];
+  return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+/* Compresses IN_LEN bytes from IN into OUT, which has room for
+   OUT_LEN bytes.  Returns the compressed size, or 0 if the
+   output would not fit in OUT_LEN bytes.  IN_LEN must be less
+   than 65535. */
+size_t
+lzf_compress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *in = in_;
+  const uint8_t *ip = in;
+  const uint8_t *in_end = in + in_len;
+  uint8_t *out = out_;
+  uint8_t *op = out;
+  uint8_t *out_end = out + out_len;
+  size_t lit = 0;
+
+  if (out_len < 2)
+    return 0;
+  memset (htab, 0, sizeof htab);
+
+  /* Reserve the control byte of the first literal run. */
+  op++;
+
+  while (ip < in_end)
+    {
+      if (ip + 2 < in_end)
+        {
+          unsigned h = hash3 (ip);
+          const uint8_t *ref = htab[h] ? in + htab[h] - 1 : NULL;
+          size_t off;
+
+          htab[h] = ip - in + 1;
+          if (ref != NULL && (off = ip - ref - 1) < MAX_OFF
+              && ref[0] == ip[0] && ref[1] == ip[1] && ref[2] == ip[2])
+            {
+              size_t max_len = in_end - ip;
+              size_t len = 3;
+
+              if (max_len > MAX_REF)
+                max_len = MAX_REF;
+              while (len < max_len && ref[len] == ip[len])
+                len++;
+
+              /* Control byte, length byte, offset byte, and the
+                 control byte of the next literal run. */
+              if (op + 4 > out_end)
+                return 0;
+
+              /* Close the open literal run, or drop its unused
+                 control byte. */
+              if (lit > 0)
+                op[-(int) lit - 1] = lit - 1;
+              else
+                op--;
+
+              len -= 2;
+              if (len < 7)
+                *op++ = (off >> 8) + (len << 5);
+              else
+                {
+                  *op++ = (off >> 8) + (7 << 5);
+                  *op++ = len - 7;
+                }
+              *op++ = off;
+
+              ip += len + 2;
+              lit = 0;
+              op++;
+              continue;
+            }
+        }
+
+      /* Literal byte, then possibly the next run's control byte. */
+      if (op + 2 > out_end)
+        return 0;
+      *op++ = *ip++;
+      if (++lit == MAX_LIT)
+        {
+          op[-(int) lit - 1] = lit - 1;
+          lit = 0;
+          op++;
+        }
+    }
+
+  if (lit > 0)
+    op[-(int) lit - 1] = lit - 1;
+  else
+    op--;
+  return op - out;
+}
+
+/* Decompresses IN_LEN bytes from IN into OUT, which has room for
+   OUT_LEN bytes.  Returns the decompressed size, or 0 if IN is
+   malformed or would overflow OUT. */
+size_t
+lzf_decompress (const void *in_, size_t in_len, void *out_, size_t out_len)
+{
+  const uint8_t *ip = in_;
+  const uint8_t *in_end = ip + in_len;
+  uint8_t *out = out_;
+  uint8_t *op = out;
+  uint8_t *out_end = out + out_len;
+
+  while (ip < in_end)
+    {
+      unsigned ctrl = *ip++;
+
+      if (ctrl < MAX_LIT)
+        {
+          size_t len = ctrl + 1;
+
+          if (op + len > out_end || ip + len > in_end)
+            return 0;
+          memcpy (op, ip, len);
+          op += len;
+          ip += len;
+        }
+      else
+        {
+          size_t len = ctrl >> 5;
+          const uint8_t *ref;
+
+          if (len == 7)
+            {
+              if (ip >= in_end)
+                return 0;
+              len += *ip++;
+            }
+          if (ip >= in_end)
+            return 0;
+          ref = op - ((ctrl & 0x1f) << 8) - *ip++ - 1;
+          len += 2;
+          if (op + len > out_end || ref < out)
+            return 0;
+          while (len-- > 0)
+            *op++ = *ref++;
+        }
+    }
+  return op - out;
+}
@@ -0,0 +1,181 @@
+#include <malloc.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+
+/* A size-class allocator for user programs.
+
+   Every block, header included, is a power of two from 32 bytes
+   up, and each size class keeps its own free list, so malloc()
+   and free() are a list pop and push in the common case.  When a
+   class runs dry, a batch of blocks worth REFILL_BYTES is carved
+   from the arena at once.  The arena grows with sbrk() in steps
+   of ARENA_CHUNK bytes, so a program makes one system call per
+   64 kB or so of new memory.
+
+   Freed blocks stay in their class and are never returned to
+   the kernel.  User processes have a single thread, so there is
+   no locking and no per-thread cache. */
+
+#define MIN_SHIFT 5                     /* Smallest block: 32 bytes. */
+#define CLASS_CNT 40                    /* Largest block: 2**44 bytes. */
+#define ARENA_CHUNK (64 * 1024)         /* Arena growth step. */
+#define REFILL_BYTES 4096               /* Carved at once for small classes. */
+
+/* Header in front of every allocated block.  Its size keeps the
+   returned memory 16-byte aligned. */
+struct header {
+	size_t cls;                     /* Size class. */
+	size_t pad;
+};
+
+/* A block on a free list, reusing the header's space. */
+struct free_block {
+	struct free_block *next;
+};
+
+static struct free_block *free_lists[CLASS_CNT];
+static uint8_t *arena_ptr;              /* Next free byte of the arena. */
+static uint8_t *arena_end;              /* End of the arena (the break). */
+
+/* Returns the class of a block with SIZE bytes of payload. */
+static inline int
+size_to_class (size_t size) {
+	size_t total = size + sizeof (struct header);
+
+	if (total <= (1u << MIN_SHIFT))
+		return 0;
+	return 64 - __builtin_clzll (total - 1) - MIN_SHIFT;
+}
+
+/* Returns the size of a block in class CLS, header included. */
+static inline size_t
+class_size (int cls) {
+	return (size_t) 1 << (cls + MIN_SHIFT);
+}
+
+/* Takes SIZE bytes from the arena, growing it if needed.
+   Returns a null pointer if the break cannot be moved. */
+static void *
+arena_alloc (size_t size) {
+	uint8_t *p;
+
+	if ((size_t) (arena_end - arena_ptr) < size) {
+		size_t grow = ROUND_UP (size + 16, ARENA_CHUNK);
+		uint8_t *start = sbrk (grow);
+
+		if (start == (void *) -1)
+			return NULL;
+		/* The program moved the break itself, so the rest of
+		   the old arena is not contiguous with the new one. */
+		if (start != arena_end)
+			arena_ptr = (uint8_t *) ROUND_UP ((uintptr_t) start, 16);
+		arena_end = start + grow;
+	}
+	p = arena_ptr;
+	arena_ptr += size;
+	return p;
+}
+
+/* Adds a batch of fresh blocks to class CLS's free list.
+   Returns false if out of memory. */
+static bool
+refill (int cls) {
+	size_t size = class_size (cls);
+	size_t cnt = size < REFILL_BYTES ? REFILL_BYTES / size : 1;
+	uint8_t *p = arena_alloc (cnt * size);
+
+	if (p == NULL)
+		return false;
+	while (cnt-- > 0) {
+		struct free_block *b = (struct free_block *) (p + cnt * size);
+		b->next = free_lists[cls];
+		free_lists[cls] = b;
+	}
+	return true;
+}
+
+/* Obtains and returns a new block of at least SIZE bytes.
+   Returns a null pointer if memory is not available. */
+void *
+malloc (size_t size) {
+	struct free_block *b;
+	struct header *h;
+	int cls;
+
+	if (size == 0 || size > class_size (CLASS_CNT - 1) - sizeof *h)
+		return NULL;
+	cls = size_to_class (size);
+	if (free_lists[cls] == NULL && !refill (cls))
+		return NULL;
+
+	b = free_lists[cls];
+	free_lists[cls] = b->next;
+	h = (struct header *) b;
+	h->cls = cls;
+	return h + 1;
+}
+
+/* Allocates and returns A times B bytes initialized to zeroes.
+   Returns a null pointer if memory is not available. */
+void *
+calloc (size_t a, size_t b) {
+	void *p;
+	size_t size;
+
+	size = a * b;
+	if (size < a || size < b)
+		return NULL;
+
+	p = malloc (size);
+	if (p != NULL)
+		memset (p, 0, size);
+	return p;
+}
+
+/* Attempts to resize OLD_BLOCK to NEW_SIZE bytes, possibly
+   moving it in the process.  If successful, returns the new
+   block; on failure, returns a null pointer.  A call with null
+   OLD_BLOCK is equivalent to malloc(NEW_SIZE).  A call with zero
+   NEW_SIZE is equivalent to free(OLD_BLOCK). */
+void *
+realloc (void *old_block, size_t new_size) {
+	struct header *h;
+	size_t old_size;
+	void *new_block;
+
+	if (new_size == 0) {
+		free (old_block);
+		return NULL;
+	}
+	if (old_block == NULL)
+		return malloc (new_size);
+
+	h = (struct header *) old_block - 1;
+	old_size = class_size (h->cls) - sizeof *h;
+	if (new_size <= old_size)
+		return old_block;
+
+	new_block = malloc (new_size);
+	if (new_block != NULL) {
+		memcpy (new_block, old_block, old_size);
+		free (old_block);
+	}
+	return new_block;
+}
+
+/* Frees block P, which must have been previously allocated with
+   malloc(), calloc(), or realloc(). */
+void
+free (void *p) {
+	struct free_block *b;
+	int cls;
+
+	if (p == NULL)
+		return;
+	b = (struct free_block *) ((struct header *) p - 1);
+	cls = ((struct header *) b)->cls;
+	b->next = free_lists[cls];
+	free_lists[cls] = b;
+}
@@ -157,6 +157,37 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+int
+msync (void *addr, size_t length) {
+	return syscall2 (SYS_MSYNC, addr, length);
+}
+
+/* Current program break, or NULL if not yet asked for. */
+static void *cur_brk;
+
+int
+brk (void *addr) {
+	cur_brk = (void *) syscall1 (SYS_BRK, addr);
+	return cur_brk == addr ? 0 : -1;
+}
+
+void *
+sbrk (intptr_t increment) {
+	void *old;
+
+	if (cur_brk == NULL)
+		cur_brk = (void *) syscall1 (SYS_BRK, NULL);
+	old = cur_brk;
+	if (increment != 0 && brk (old + increment) < 0)
+		return (void *) -1;
+	return old;
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
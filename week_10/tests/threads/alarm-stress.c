@@ -0,0 +1,89 @@
+/* Creates 1,000 threads that each sleep 5 times for durations
+   between 1 and 50 ticks, so that the sleep queue holds
+   hundreds of sleepers with many different wake-up times.
+   Verifies that no thread wakes up early and that every sleep
+   completes. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 1000
+#define ITERATIONS 5
+
+/* Information about an individual thread in the test. */
+struct stress_thread
+  {
+    int duration;               /* Number of ticks to sleep. */
+    int wakeups;                /* Sleeps completed. */
+    int early;                  /* Sleeps that ended too soon. */
+  };
+
+static struct semaphore done;
+
+static void sleeper (void *);
+
+void
+test_alarm_stress (void)
+{
+  struct stress_thread *threads;
+  int i;
+
+  msg ("Creating %d threads to sleep %d times each.",
+       THREAD_CNT, ITERATIONS);
+
+  threads = malloc (sizeof *threads * THREAD_CNT);
+  if (threads == NULL)
+    PANIC ("couldn't allocate memory for test");
+  sema_init (&done, 0);
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      struct stress_thread *t = threads + i;
+      char name[16];
+
+      t->duration = 1 + i * 7 % 50;
+      t->wakeups = 0;
+      t->early = 0;
+
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, t) == TID_ERROR)
+        fail ("couldn't create thread %d", i);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&done);
+  msg ("All threads finished.");
+
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      if (threads[i].early != 0)
+        fail ("thread %d woke up early %d times", i, threads[i].early);
+      if (threads[i].wakeups != ITERATIONS)
+        fail ("thread %d woke up %d times instead of %d",
+              i, threads[i].wakeups, ITERATIONS);
+    }
+  free (threads);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *t_)
+{
+  struct stress_thread *t = t_;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int64_t sleep_until = timer_ticks () + t->duration;
+
+      timer_sleep (t->duration);
+      if (timer_ticks () < sleep_until)
+        t->early++;
+      t->wakeups++;
+    }
+  sema_up (&done);
+}
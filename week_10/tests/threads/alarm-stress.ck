@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(alarm-stress) begin
+(alarm-stress) Creating 1000 threads to sleep 5 times each.
+(alarm-stress) All threads finished.
+(alarm-stress) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Measures what sub-tick sleeps cost the rest of the system.
+
+   The main thread sleeps 1,000 times for 100 us with
+   timer_usleep() while a lower priority thread counts loop
+   iterations in the background.  With the periodic PIT these
+   sleeps spin in busy_wait(), so the background thread barely
+   runs; with the one-shot local APIC timer they block, and the
+   background thread gets the CPU in between.  Prints the ticks
+   the sleeps took and the background thread's count.  Run with
+   and without -nolapic to compare. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPS 1000
+#define SLEEP_US 100
+
+static volatile bool done;
+static struct semaphore finished;
+static long long background_loops;
+
+static void
+background (void *aux UNUSED)
+{
+  while (!done)
+    background_loops++;
+  sema_up (&finished);
+}
+
+void
+test_hrtimer_bench (void)
+{
+  int64_t start, elapsed;
+  int i;
+
+  sema_init (&finished, 0);
+  thread_set_priority (PRI_DEFAULT + 1);
+  thread_create ("background", PRI_DEFAULT, background, NULL);
+
+  start = timer_ticks ();
+  for (i = 0; i < SLEEPS; i++)
+    timer_usleep (SLEEP_US);
+  elapsed = timer_elapsed (start);
+
+  done = true;
+  sema_down (&finished);
+  msg ("%d sleeps of %d us in %lld ticks", SLEEPS, SLEEP_US, elapsed);
+  msg ("background thread: %lld loops", background_loops);
+  pass ();
+}
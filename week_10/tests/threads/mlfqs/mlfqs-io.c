@@ -0,0 +1,104 @@
+/* Checks that the advanced scheduler favours an I/O-bound thread
+   over CPU-bound ones.
+
+   Two threads spin for 10 seconds while a third sleeps until
+   every 4th timer tick and notes how late it woke up.  The
+   sleeping thread uses little CPU, so its recent_cpu stays low
+   and its priority should end up above the spinning threads',
+   which lets it run as soon as its sleep ends instead of waiting
+   for a time slice.  At least half of its wakeups should be on
+   time. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define CPU_THREAD_CNT 2
+#define TEST_SECONDS 10
+#define IO_PERIOD 4
+
+struct result
+  {
+    int priority;               /* Priority at the end of the run. */
+    int recent_cpu;             /* 100 times recent_cpu at the end. */
+  };
+
+static struct semaphore done;
+static int64_t end_time;
+static struct result cpu_results[CPU_THREAD_CNT];
+static struct result io_result;
+static int io_wakeups;
+static int io_late_wakeups;
+
+static void cpu_thread (void *result_);
+static void io_thread (void *aux);
+
+void
+test_mlfqs_io (void)
+{
+  int i;
+
+  ASSERT (thread_mlfqs);
+
+  sema_init (&done, 0);
+  end_time = timer_ticks () + TEST_SECONDS * TIMER_FREQ;
+
+  msg ("Starting %d CPU-bound threads and 1 I/O-bound thread "
+       "for %d seconds...", CPU_THREAD_CNT, TEST_SECONDS);
+  for (i = 0; i < CPU_THREAD_CNT; i++)
+    thread_create ("cpu", PRI_DEFAULT, cpu_thread, &cpu_results[i]);
+  thread_create ("io", PRI_DEFAULT, io_thread, NULL);
+  for (i = 0; i < CPU_THREAD_CNT + 1; i++)
+    sema_down (&done);
+
+  for (i = 0; i < CPU_THREAD_CNT; i++)
+    {
+      if (io_result.priority <= cpu_results[i].priority)
+        fail ("I/O thread priority %d is not above CPU thread %d's %d",
+              io_result.priority, i, cpu_results[i].priority);
+      if (io_result.recent_cpu >= cpu_results[i].recent_cpu)
+        fail ("I/O thread recent_cpu %d.%02d is not below "
+              "CPU thread %d's %d.%02d",
+              io_result.recent_cpu / 100, io_result.recent_cpu % 100, i,
+              cpu_results[i].recent_cpu / 100, cpu_results[i].recent_cpu % 100);
+    }
+  if (io_late_wakeups * 2 > io_wakeups)
+    fail ("I/O thread woke up late %d times out of %d",
+          io_late_wakeups, io_wakeups);
+  msg ("I/O-bound thread got ahead of the CPU-bound threads.");
+}
+
+static void
+cpu_thread (void *result_)
+{
+  struct result *result = result_;
+
+  while (timer_ticks () < end_time)
+    continue;
+  result->priority = thread_get_priority ();
+  result->recent_cpu = thread_get_recent_cpu ();
+  sema_up (&done);
+}
+
+static void
+io_thread (void *aux UNUSED)
+{
+  for (;;)
+    {
+      int64_t now = timer_ticks ();
+      int64_t wakeup = now - now % IO_PERIOD + IO_PERIOD;
+
+      if (wakeup >= end_time)
+        break;
+      timer_sleep (wakeup - now);
+      io_wakeups++;
+      if (timer_ticks () > wakeup)
+        io_late_wakeups++;
+    }
+  io_result.priority = thread_get_priority ();
+  io_result.recent_cpu = thread_get_recent_cpu ();
+  sema_up (&done);
+}
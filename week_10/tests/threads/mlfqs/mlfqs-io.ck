@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mlfqs-io) begin
+(mlfqs-io) Starting 2 CPU-bound threads and 1 I/O-bound thread for 10 seconds...
+(mlfqs-io) I/O-bound thread got ahead of the CPU-bound threads.
+(mlfqs-io) end
+EOF
+pass;
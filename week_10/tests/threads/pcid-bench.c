@@ -0,0 +1,91 @@
+/* Measures the cost of switching address spaces when every
+   switch is followed by touching the same working set.
+
+   Builds two page tables that map TOUCH_PAGES pages at the same
+   user addresses, then switches between them ROUNDS times,
+   reading one word from each page after every switch.  Runs the
+   loop once with PCIDs turned off, so that every CR3 load
+   flushes the TLB, and once with them on, so that each address
+   space's translations survive the other's turn, and prints the
+   ticks each run took. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#ifdef USERPROG
+#define SPACES 2
+#define TOUCH_PAGES 64
+#define ROUNDS 20000
+#define UADDR ((uint8_t *) 0x10000000)
+
+static uint64_t *spaces[SPACES];
+
+static int64_t
+run (const char *name, bool pcid)
+{
+  struct thread *t = thread_current ();
+  uint64_t sum = 0;
+  int64_t start, ticks;
+
+  pcid_enabled = pcid;
+  start = timer_ticks ();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int s = 0; s < SPACES; s++)
+      {
+        /* A preemption reactivates T's pml4, so keep it in step. */
+        t->pml4 = spaces[s];
+        pml4_activate (spaces[s]);
+        for (size_t i = 0; i < TOUCH_PAGES; i++)
+          sum += *(volatile uint64_t *) (UADDR + i * PGSIZE);
+      }
+  ticks = timer_elapsed (start);
+
+  t->pml4 = NULL;
+  pml4_activate (NULL);
+  if (sum != 0)
+    fail ("read %llu from zeroed pages", (unsigned long long) sum);
+  msg ("%s: %d switches in %lld ticks", name, ROUNDS * SPACES, ticks);
+  return ticks;
+}
+#endif
+
+void
+test_pcid_bench (void)
+{
+#ifdef USERPROG
+  bool have_pcid = pcid_enabled;
+
+  for (int s = 0; s < SPACES; s++)
+    {
+      spaces[s] = pml4_create ();
+      if (spaces[s] == NULL)
+        fail ("out of memory");
+      for (size_t i = 0; i < TOUCH_PAGES; i++)
+        {
+          void *kpage = palloc_get_page (PAL_ZERO);
+          if (kpage == NULL
+              || !pml4_set_page (spaces[s], UADDR + i * PGSIZE, kpage, false))
+            fail ("out of memory");
+        }
+    }
+  msg ("%d address spaces, %d pages each, %d rounds",
+       SPACES, TOUCH_PAGES, ROUNDS);
+
+  run ("flush", false);
+  if (have_pcid)
+    run ("pcid", true);
+  else
+    msg ("pcid: not supported by this CPU or disabled with -nopcid");
+
+  for (int s = 0; s < SPACES; s++)
+    pml4_destroy (spaces[s]);
+  pass ();
+#else
+  fail ("requires USERPROG");
+#endif
+}
@@ -0,0 +1,113 @@
+/* Compares the ready queue the scheduler used to have, a list
+   kept sorted by priority with list_insert_ordered(), against
+   the per-priority run queue with an occupancy bitmap.
+
+   For 10, 100 and 1000 queued threads, repeatedly takes the
+   highest priority thread off the queue and puts it back with a
+   new random priority, as a thread that ran, blocked and was
+   woken up would be, and prints the ticks each queue took.  Both
+   queues see the same priorities and must hand out threads in
+   the same order. */
+
+#include <stdio.h>
+#include <list.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/runq.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define MAX_THREADS 1000
+#define OPS 20000
+
+static struct thread *threads[MAX_THREADS];
+static struct list sorted;
+static struct runq rq;
+
+static bool
+higher_priority (const struct list_elem *a, const struct list_elem *b,
+                 void *aux UNUSED)
+{
+  return list_entry (a, struct thread, elem)->priority
+         > list_entry (b, struct thread, elem)->priority;
+}
+
+static void
+queue_push (bool use_runq, struct thread *t)
+{
+  if (use_runq)
+    runq_push (&rq, t);
+  else
+    list_insert_ordered (&sorted, &t->elem, higher_priority, NULL);
+}
+
+static struct thread *
+queue_pop (bool use_runq)
+{
+  if (use_runq)
+    return runq_pop (&rq);
+  return list_entry (list_pop_front (&sorted), struct thread, elem);
+}
+
+static int
+random_priority (void)
+{
+  return PRI_MIN + random_ulong () % (PRI_MAX - PRI_MIN + 1);
+}
+
+/* Runs the workload with N threads and returns a checksum of the
+   order threads came off the queue. */
+static unsigned long
+run (const char *name, bool use_runq, int n)
+{
+  unsigned long sum = 0;
+  int64_t start;
+
+  list_init (&sorted);
+  runq_init (&rq);
+  random_init (n);
+  for (int i = 0; i < n; i++)
+    {
+      threads[i]->priority = random_priority ();
+      queue_push (use_runq, threads[i]);
+    }
+
+  start = timer_ticks ();
+  for (int i = 0; i < OPS; i++)
+    {
+      struct thread *t = queue_pop (use_runq);
+
+      sum = sum * 31 + (t - threads[0]);
+      t->priority = random_priority ();
+      queue_push (use_runq, t);
+    }
+  msg ("%4d threads, %s: %d operations in %lld ticks",
+       n, name, OPS, timer_elapsed (start));
+
+  for (int i = 0; i < n; i++)
+    queue_pop (use_runq);
+  return sum;
+}
+
+void
+test_runq_bench (void)
+{
+  static const int counts[] = {10, 100, MAX_THREADS};
+
+  /* Stand-ins that only ever sit in the queues above. */
+  threads[0] = calloc (MAX_THREADS, sizeof *threads[0]);
+  if (threads[0] == NULL)
+    fail ("out of memory");
+  for (int i = 1; i < MAX_THREADS; i++)
+    threads[i] = threads[0] + i;
+
+  for (size_t i = 0; i < sizeof counts / sizeof *counts; i++)
+    if (run ("sorted list", false, counts[i])
+        != run ("runq", true, counts[i]))
+      fail ("queues disagree on scheduling order with %d threads",
+            counts[i]);
+
+  free (threads[0]);
+  pass ();
+}
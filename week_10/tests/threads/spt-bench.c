@@ -0,0 +1,137 @@
+/* Compares the cost of supplemental page table lookups against
+   the hash table the SPT used to be, which allocated a dummy
+   page on every lookup.
+
+   Builds both indexes over the same pages, laid out like a small
+   process (a dense text/data range and a stack at the top of user
+   memory), then looks up every page, plus one address that is not
+   mapped, in a loop and prints the ticks each index took. */
+
+#include <stdio.h>
+#include <hash.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+#ifdef VM
+#include "vm/vm.h"
+#include "vm/uninit.h"
+#endif
+
+#ifdef VM
+#define TEXT_PAGES 256
+#define STACK_PAGES 32
+#define ROUNDS 500
+
+struct hnode
+  {
+    struct hash_elem elem;
+    void *va;
+  };
+
+static uint64_t
+hnode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct hnode *n = hash_entry (e, struct hnode, elem);
+  return hash_bytes (&n->va, sizeof n->va);
+}
+
+static bool
+hnode_less (const struct hash_elem *a, const struct hash_elem *b,
+            void *aux UNUSED)
+{
+  return hash_entry (a, struct hnode, elem)->va
+         < hash_entry (b, struct hnode, elem)->va;
+}
+
+static void
+hnode_free (struct hash_elem *e, void *aux UNUSED)
+{
+  free (hash_entry (e, struct hnode, elem));
+}
+
+/* The old spt_find_page(). */
+static struct hnode *
+hash_lookup (struct hash *h, void *va)
+{
+  struct hnode *key = malloc (sizeof *key);
+  struct hash_elem *e;
+
+  key->va = pg_round_down (va);
+  e = hash_find (h, &key->elem);
+  free (key);
+  return e != NULL ? hash_entry (e, struct hnode, elem) : NULL;
+}
+
+static void *vas[TEXT_PAGES + STACK_PAGES + 1];
+static size_t va_cnt;
+
+static void
+add_range (void *base, size_t cnt)
+{
+  for (size_t i = 0; i < cnt; i++)
+    vas[va_cnt++] = base + i * PGSIZE + 0x123;
+}
+
+static void
+report (const char *name, int64_t ticks)
+{
+  long long lookups = (long long) ROUNDS * va_cnt;
+  msg ("%s: %lld lookups in %lld ticks", name, lookups, ticks);
+}
+#endif
+
+void
+test_spt_bench (void)
+{
+#ifdef VM
+  struct supplemental_page_table spt;
+  struct hash h;
+  int64_t start;
+  size_t found;
+
+  add_range ((void *) 0x400000, TEXT_PAGES);
+  add_range ((void *) (USER_STACK - STACK_PAGES * PGSIZE), STACK_PAGES);
+  vas[va_cnt++] = (void *) 0x10000000;  /* Not mapped. */
+
+  supplemental_page_table_init (&spt);
+  hash_init (&h, hnode_hash, hnode_less, NULL);
+  for (size_t i = 0; i + 1 < va_cnt; i++)
+    {
+      struct page *page = malloc (sizeof *page);
+      struct hnode *n = malloc (sizeof *n);
+      if (page == NULL || n == NULL)
+        fail ("out of memory");
+      uninit_new (page, pg_round_down (vas[i]), NULL, VM_ANON, NULL, NULL);
+      if (!spt_insert_page (&spt, page))
+        fail ("spt_insert_page failed for %p", vas[i]);
+      n->va = pg_round_down (vas[i]);
+      hash_insert (&h, &n->elem);
+    }
+  msg ("%zu pages, %d rounds", va_cnt - 1, ROUNDS);
+
+  found = 0;
+  start = timer_ticks ();
+  for (int r = 0; r < ROUNDS; r++)
+    for (size_t i = 0; i < va_cnt; i++)
+      found += hash_lookup (&h, vas[i]) != NULL;
+  report ("hash", timer_elapsed (start));
+  if (found != (size_t) ROUNDS * (va_cnt - 1))
+    fail ("hash found %zu pages", found);
+
+  found = 0;
+  start = timer_ticks ();
+  for (int r = 0; r < ROUNDS; r++)
+    for (size_t i = 0; i < va_cnt; i++)
+      found += spt_find_page (&spt, vas[i]) != NULL;
+  report ("radix", timer_elapsed (start));
+  if (found != (size_t) ROUNDS * (va_cnt - 1))
+    fail ("spt found %zu pages", found);
+
+  hash_destroy (&h, hnode_free);
+  supplemental_page_table_kill (&spt);
+  pass ();
+#else
+  fail ("requires VM");
+#endif
+}
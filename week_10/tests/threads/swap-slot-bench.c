@@ -0,0 +1,94 @@
+/* Measures how much work the swap slot allocator does per
+   allocation as the swap disk fills up.
+
+   Fills the swap disk in ten steps, printing the average number
+   of slot clusters examined per allocation in each step, then
+   frees a random half of the slots and fills the disk again.
+   With a next-fit cursor the cost should stay flat instead of
+   growing with the number of used slots.
+
+   Must run before any user process has swapped anything out. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "threads/thread.h"
+#ifdef VM
+#include "vm/anon.h"
+#endif
+
+#ifdef VM
+/* Allocates slots until CNT * 10% more are in use, ten times.
+   Successive allocations alternate between two owners so that
+   they go through the next-fit search rather than the
+   adjacent-slot shortcut for a single owner. */
+static void
+fill (int *slots, size_t *used, size_t cnt)
+{
+  for (int step = 1; step <= 10; step++)
+    {
+      size_t goal = cnt * step / 10;
+      size_t allocs = 0;
+      long long probes = anon_slot_probes ();
+
+      for (; *used < goal; (*used)++, allocs++)
+        {
+          int slot = anon_slot_alloc (*used & 1 ? thread_current () : NULL);
+          if (slot < 0)
+            fail ("ran out of slots at %zu of %zu", *used, cnt);
+          slots[*used] = slot;
+        }
+      probes = anon_slot_probes () - probes;
+      msg ("%3d%% full: %lld.%02lld clusters per allocation",
+           step * 10, allocs ? probes / allocs : 0,
+           allocs ? probes * 100 / allocs % 100 : 0);
+    }
+}
+#endif
+
+void
+test_swap_slot_bench (void) 
+{
+#ifdef VM
+  size_t cnt = 0, used = 0;
+  int *slots;
+  int slot;
+
+  /* Count the slots by allocating all of them. */
+  while ((slot = anon_slot_alloc (NULL)) >= 0)
+    cnt++;
+  slots = malloc (cnt * sizeof *slots);
+  if (slots == NULL)
+    fail ("out of memory");
+  for (size_t i = 0; i < cnt; i++)
+    anon_slot_release (i);
+  msg ("%zu swap slots", cnt);
+
+  msg ("filling empty swap");
+  fill (slots, &used, cnt);
+
+  msg ("freeing a random half");
+  random_init (0);
+  for (size_t i = 0; i < cnt; i++)
+    {
+      size_t j = random_ulong () % cnt;
+      int tmp = slots[i];
+      slots[i] = slots[j];
+      slots[j] = tmp;
+    }
+  for (size_t i = cnt / 2; i < cnt; i++)
+    anon_slot_release (slots[i]);
+  used = cnt / 2;
+
+  msg ("refilling fragmented swap");
+  fill (slots, &used, cnt);
+
+  for (size_t i = 0; i < cnt; i++)
+    anon_slot_release (slots[i]);
+  free (slots);
+  pass ();
+#else
+  fail ("requires VM");
+#endif
+}
@@ -17,6 +17,7 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-stress", test_alarm_stress},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -38,6 +39,12 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-io", test_mlfqs_io},
+    {"swap-slot-bench", test_swap_slot_bench},
+    {"spt-bench", test_spt_bench},
+    {"pcid-bench", test_pcid_bench},
+    {"runq-bench", test_runq_bench},
+    {"hrtimer-bench", test_hrtimer_bench},
   };
 
 static const char *test_name;
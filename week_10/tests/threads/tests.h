@@ -11,6 +11,7 @@ extern test_func test_alarm_simultaneous;
 extern test_func test_alarm_priority;
 extern test_func test_alarm_zero;
 extern test_func test_alarm_negative;
+extern test_func test_alarm_stress;
 extern test_func test_priority_change;
 extern test_func test_priority_donate_one;
 extern test_func test_priority_donate_multiple;
@@ -32,6 +33,12 @@ extern test_func test_mlfqs_fair_20;
 extern test_func test_mlfqs_nice_2;
 extern test_func test_mlfqs_nice_10;
 extern test_func test_mlfqs_block;
+extern test_func test_mlfqs_io;
+extern test_func test_swap_slot_bench;
+extern test_func test_spt_bench;
+extern test_func test_pcid_bench;
+extern test_func test_runq_bench;
+extern test_func test_hrtimer_bench;
 
 void msg (const char *, ...);
 void fail (const char *, ...);
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-fork-rss) begin
+(cow-fork-rss) forked 8 children
+(cow-fork-rss) parent can write after fork
+(cow-fork-rss) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Touches one byte of a large anonymous mapping and checks that
+   the whole 2 MB region around it was mapped at once, with
+   physically contiguous and aligned frames, and that it reads
+   and writes like ordinary anonymous memory. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (2 * 1024 * 1024)
+#define HUGE_PAGES (HUGE_SIZE / PAGE_SIZE)
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  char *base;
+  size_t i;
+
+  CHECK (mmap (ACTUAL, 2 * HUGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == ACTUAL,
+         "mmap 4 MB of anonymous memory");
+  ACTUAL[100] = 'x';
+
+  base = get_phys_addr (ACTUAL);
+  if (base == NULL || (unsigned long) base % HUGE_SIZE != 0)
+    fail ("first page is not backed by an aligned 2 MB frame");
+  for (i = 1; i < HUGE_PAGES; i++)
+    if (get_phys_addr (ACTUAL + i * PAGE_SIZE) != base + i * PAGE_SIZE)
+      fail ("page %zu is not part of the 2 MB frame", i);
+  msg ("one fault mapped the whole 2 MB region");
+
+  CHECK (ACTUAL[100] == 'x' && ACTUAL[0] == 0 && ACTUAL[HUGE_SIZE - 1] == 0,
+         "region holds written data and zeros");
+  for (i = 0; i < HUGE_SIZE; i += PAGE_SIZE)
+    ACTUAL[i] = i / PAGE_SIZE;
+  for (i = 0; i < HUGE_SIZE; i += PAGE_SIZE)
+    if (ACTUAL[i] != (char) (i / PAGE_SIZE))
+      fail ("page %zu reads back wrong", i / PAGE_SIZE);
+  msg ("every page is writable");
+  munmap (ACTUAL);
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(huge-anon) begin
+(huge-anon) mmap 4 MB of anonymous memory
+(huge-anon) one fault mapped the whole 2 MB region
+(huge-anon) region holds written data and zeros
+(huge-anon) every page is writable
+(huge-anon) end
+EOF
+pass;
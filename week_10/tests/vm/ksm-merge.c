@@ -0,0 +1,64 @@
+/* Fills several pages with the same contents and checks that the
+   same-page merging daemon (-ksm) maps them to a single frame,
+   and that writing to one of them gives it a private copy again.
+   Reading a file blocks on the disk, which lets the low-priority
+   daemon run while the test waits. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 16
+#define MAX_TRIES 10000
+
+static char pages[(PAGE_COUNT + 1) * PAGE_SIZE];
+
+/* Returns true if all test pages map the same frame. */
+static bool
+merged (void)
+{
+  void *pa = get_phys_addr (&pages[PAGE_SIZE]);
+  size_t i;
+
+  for (i = 2; i <= PAGE_COUNT; i++)
+    if (get_phys_addr (&pages[i * PAGE_SIZE]) != pa)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  char buf[512];
+  size_t i;
+  int fd, tries;
+
+  /* Skip the first page, which may share a frame with .data. */
+  for (i = 1; i <= PAGE_COUNT; i++)
+    memset (&pages[i * PAGE_SIZE], 0x5a, PAGE_SIZE);
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (tries = 0; tries < MAX_TRIES && !merged (); tries++)
+    {
+      seek (fd, 0);
+      while (read (fd, buf, sizeof buf) > 0)
+        continue;
+    }
+  close (fd);
+  CHECK (merged (), "identical pages share one frame");
+
+  pages[3 * PAGE_SIZE] = 'a';
+  CHECK (get_phys_addr (&pages[3 * PAGE_SIZE])
+         != get_phys_addr (&pages[2 * PAGE_SIZE]),
+         "written page gets a private frame");
+  CHECK (pages[3 * PAGE_SIZE] == 'a' && pages[3 * PAGE_SIZE + 1] == 0x5a,
+         "written data is kept");
+  for (i = 1; i <= PAGE_COUNT; i++)
+    if (i != 3 && pages[i * PAGE_SIZE] != 0x5a)
+      fail ("page %zu changed", i);
+  msg ("other pages are unchanged");
+}
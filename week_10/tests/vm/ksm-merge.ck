@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) open "sample.txt"
+(ksm-merge) identical pages share one frame
+(ksm-merge) written page gets a private frame
+(ksm-merge) written data is kept
+(ksm-merge) other pages are unchanged
+(ksm-merge) end
+EOF
+pass;
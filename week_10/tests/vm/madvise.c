@@ -0,0 +1,47 @@
+/* Checks madvise(): WILLNEED reads a mapped file page in the
+   background so that it is resident before it is touched, and
+   DONTNEED frees an anonymous page, which then reads back as
+   zeros. */
+
+#include <string.h>
+#include <round.h>
+#include <syscall.h>
+#include <stdint.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MAX_TRIES 1000
+
+static char bss[3 * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  char *anon = (char *) ROUND_UP ((uintptr_t) bss + 1, PAGE_SIZE);
+  char buf[64];
+  int handle, tries;
+
+  CHECK (madvise (actual + 1, PAGE_SIZE, MADV_WILLNEED) == -1,
+         "unaligned address is rejected");
+  CHECK (madvise (anon, PAGE_SIZE, 99) == -1, "unknown advice is rejected");
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 0, handle, 0) != MAP_FAILED, "mmap \"sample.txt\"");
+  CHECK (madvise (actual, PAGE_SIZE, MADV_WILLNEED) == 0, "madvise WILLNEED");
+  for (tries = 0; tries < MAX_TRIES && get_phys_addr (actual) == 0; tries++)
+    read (handle, buf, sizeof buf);
+  CHECK (get_phys_addr (actual) != 0, "page is read in before it is touched");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+  munmap (actual);
+  close (handle);
+
+  memset (anon, 'x', PAGE_SIZE);
+  CHECK (get_phys_addr (anon) != 0, "written page is resident");
+  CHECK (madvise (anon, PAGE_SIZE, MADV_DONTNEED) == 0, "madvise DONTNEED");
+  CHECK (get_phys_addr (anon) == 0, "DONTNEED frees the frame");
+  CHECK (anon[0] == 0 && anon[PAGE_SIZE - 1] == 0, "freed page reads back as zeros");
+}
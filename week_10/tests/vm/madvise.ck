@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise) begin
+(madvise) unaligned address is rejected
+(madvise) unknown advice is rejected
+(madvise) open "sample.txt"
+(madvise) mmap "sample.txt"
+(madvise) madvise WILLNEED
+(madvise) page is read in before it is touched
+(madvise) written page is resident
+(madvise) madvise DONTNEED
+(madvise) DONTNEED frees the frame
+(madvise) freed page reads back as zeros
+(madvise) end
+EOF
+pass;
@@ -0,0 +1,80 @@
+/* Moves the program break with sbrk(), then allocates, fills,
+   resizes and frees blocks of many sizes with malloc() and
+   checks that none of them overlap. */
+
+#include <malloc.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define BLOCKS 64
+
+static char *blocks[BLOCKS];
+
+static size_t
+block_size (int i)
+{
+  return 1 + (size_t) i * i * 37;
+}
+
+static void
+check_block (int i)
+{
+  size_t j;
+
+  for (j = 0; j < block_size (i); j++)
+    if (blocks[i][j] != (char) i)
+      fail ("block %d was overwritten at byte %zu", i, j);
+}
+
+void
+test_main (void)
+{
+  char *old, *p;
+  int i;
+
+  old = sbrk (0);
+  CHECK (sbrk (PAGE_SIZE) == old, "sbrk returns the old break");
+  memset (old, 'x', PAGE_SIZE);
+  CHECK (sbrk (0) == old + PAGE_SIZE, "break moved by one page");
+  CHECK (sbrk (-PAGE_SIZE) == old + PAGE_SIZE && sbrk (0) == old,
+         "break moved back");
+
+  for (i = 0; i < BLOCKS; i++)
+    {
+      blocks[i] = malloc (block_size (i));
+      if (blocks[i] == NULL)
+        fail ("malloc of %zu bytes failed", block_size (i));
+      memset (blocks[i], i, block_size (i));
+    }
+  for (i = 0; i < BLOCKS; i++)
+    check_block (i);
+  msg ("allocated %d blocks", BLOCKS);
+
+  for (i = 0; i < BLOCKS; i += 2)
+    free (blocks[i]);
+  for (i = 0; i < BLOCKS; i += 2)
+    {
+      blocks[i] = malloc (block_size (i));
+      memset (blocks[i], i, block_size (i));
+    }
+  for (i = 1; i < BLOCKS; i += 2)
+    {
+      blocks[i] = realloc (blocks[i], block_size (i) * 3);
+      if (blocks[i] == NULL)
+        fail ("realloc of block %d failed", i);
+    }
+  for (i = 0; i < BLOCKS; i++)
+    check_block (i);
+  msg ("freed, reallocated and resized blocks");
+
+  p = calloc (PAGE_SIZE, 2);
+  CHECK (p != NULL && p[0] == 0 && p[2 * PAGE_SIZE - 1] == 0,
+         "calloc returns zeroed memory");
+
+  for (i = 0; i < BLOCKS; i++)
+    free (blocks[i]);
+  free (p);
+}
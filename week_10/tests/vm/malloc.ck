@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(malloc) begin
+(malloc) sbrk returns the old break
+(malloc) break moved by one page
+(malloc) break moved back
+(malloc) allocated 64 blocks
+(malloc) freed, reallocated and resized blocks
+(malloc) calloc returns zeroed memory
+(malloc) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Maps anonymous memory, checks that it starts out zeroed and
+   is writable, and that mapping it again after munmap() gives
+   fresh zeroed pages. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 3
+#define ACTUAL ((char *) 0x10000000)
+
+static bool
+is_zero (const char *p, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  CHECK (mmap (ACTUAL, PAGES * PAGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == ACTUAL,
+         "mmap anonymous memory");
+  CHECK (is_zero (ACTUAL, PAGES * PAGE_SIZE), "mapping starts out zeroed");
+  for (i = 0; i < PAGES * PAGE_SIZE; i++)
+    ACTUAL[i] = i % 251;
+  for (i = 0; i < PAGES * PAGE_SIZE; i++)
+    if (ACTUAL[i] != (char) (i % 251))
+      fail ("byte %zu reads back wrong", i);
+  msg ("mapping holds written data");
+  CHECK (mmap (ACTUAL + PAGE_SIZE, PAGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0)
+         == MAP_FAILED, "overlapping mapping is rejected");
+  munmap (ACTUAL);
+
+  CHECK (mmap (ACTUAL, PAGE_SIZE, 1 | MAP_ANONYMOUS, -1, 0) == ACTUAL,
+         "mmap anonymous memory again");
+  CHECK (is_zero (ACTUAL, PAGE_SIZE), "new mapping is zeroed");
+  munmap (ACTUAL);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-anon) begin
+(mmap-anon) mmap anonymous memory
+(mmap-anon) mapping starts out zeroed
+(mmap-anon) mapping holds written data
+(mmap-anon) overlapping mapping is rejected
+(mmap-anon) mmap anonymous memory again
+(mmap-anon) new mapping is zeroed
+(mmap-anon) end
+EOF
+pass;
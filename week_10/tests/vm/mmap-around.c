@@ -0,0 +1,62 @@
+/* Maps one eight-page file twice with different MAP_AROUND
+   windows and checks that a fault reads in exactly as many pages
+   as its own mapping asked for, and that the pages it reads hold
+   the file's data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 8
+#define WIDE ((char *) 0x10000000)
+#define NARROW ((char *) 0x20000000)
+
+/* Checks that exactly the first CNT pages at BASE are resident. */
+static void
+check_resident (const char *name, char *base, int cnt)
+{
+  int i;
+
+  for (i = 0; i < PAGES; i++)
+    if ((get_phys_addr (base + i * PAGE_SIZE) != 0) != (i < cnt))
+      fail ("%s: page %d is %sresident", name, i, i < cnt ? "not " : "");
+  msg ("%s: %d pages resident", name, cnt);
+}
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  int handle, i;
+
+  CHECK (create ("around.dat", PAGES * PAGE_SIZE), "create \"around.dat\"");
+  CHECK ((handle = open ("around.dat")) > 1, "open \"around.dat\"");
+  for (i = 0; i < PAGES; i++)
+    {
+      seek (handle, i * PAGE_SIZE);
+      if (write (handle, sample, len) != (int) len)
+        fail ("write of page %d failed", i);
+    }
+  CHECK (mmap (WIDE, PAGES * PAGE_SIZE, MAP_AROUND (4), handle, 0) != MAP_FAILED,
+         "mmap \"around.dat\" with MAP_AROUND (4)");
+  CHECK (mmap (NARROW, PAGES * PAGE_SIZE, MAP_AROUND (1), handle, 0) != MAP_FAILED,
+         "mmap \"around.dat\" with MAP_AROUND (1)");
+
+  if (memcmp (WIDE, sample, len))
+    fail ("wide mapping has bad data");
+  check_resident ("wide", WIDE, 4);
+  for (i = 1; i < 4; i++)
+    if (memcmp (WIDE + i * PAGE_SIZE, sample, len))
+      fail ("page %d read around the fault has bad data", i);
+
+  if (memcmp (NARROW, sample, len))
+    fail ("narrow mapping has bad data");
+  check_resident ("narrow", NARROW, 1);
+
+  munmap (NARROW);
+  munmap (WIDE);
+  close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-around) begin
+(mmap-around) create "around.dat"
+(mmap-around) open "around.dat"
+(mmap-around) mmap "around.dat" with MAP_AROUND (4)
+(mmap-around) mmap "around.dat" with MAP_AROUND (1)
+(mmap-around) wide: 4 pages resident
+(mmap-around) narrow: 1 pages resident
+(mmap-around) end
+EOF
+pass;
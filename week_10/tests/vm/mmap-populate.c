@@ -0,0 +1,44 @@
+/* Maps a four-page file with MAP_POPULATE and checks that every
+   page is resident before it is touched and holds the file's
+   data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 4
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  size_t len = strlen (sample);
+  int handle, i;
+
+  CHECK (create ("populate.dat", PAGES * PAGE_SIZE), "create \"populate.dat\"");
+  CHECK ((handle = open ("populate.dat")) > 1, "open \"populate.dat\"");
+  for (i = 0; i < PAGES; i++)
+    {
+      seek (handle, i * PAGE_SIZE);
+      if (write (handle, sample, len) != (int) len)
+        fail ("write of page %d failed", i);
+    }
+  CHECK (mmap (ACTUAL, PAGES * PAGE_SIZE, 1 | MAP_POPULATE, handle, 0)
+         != MAP_FAILED, "mmap \"populate.dat\" with MAP_POPULATE");
+
+  for (i = 0; i < PAGES; i++)
+    if (get_phys_addr (ACTUAL + i * PAGE_SIZE) == 0)
+      fail ("page %d is not resident", i);
+  msg ("all pages are resident");
+
+  for (i = 0; i < PAGES; i++)
+    if (memcmp (ACTUAL + i * PAGE_SIZE, sample, len))
+      fail ("page %d has bad data", i);
+  msg ("all pages hold the file's data");
+
+  munmap (ACTUAL);
+  close (handle);
+}
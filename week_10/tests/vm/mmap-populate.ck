@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-populate) begin
+(mmap-populate) create "populate.dat"
+(mmap-populate) open "populate.dat"
+(mmap-populate) mmap "populate.dat" with MAP_POPULATE
+(mmap-populate) all pages are resident
+(mmap-populate) all pages hold the file's data
+(mmap-populate) end
+EOF
+pass;
@@ -0,0 +1,99 @@
+/* Maps a large file, touches a few pages of it, and checks that
+   only those pages are ever brought in and that unmapping writes
+   back just the ones that were written.  A child then maps part
+   of the file at an offset, writes two pages of it and exits
+   without unmapping, so its pages are written back by exit.
+   The .ck file checks that the kernel wrote exactly those pages
+   back to the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGES 128
+#define FILE_SIZE (PAGES * PAGE_SIZE - 1000)
+#define ACTUAL ((char *) 0x10000000)
+#define CHILD_MAP ((char *) 0x20000000)
+#define CHILD_OFS 40
+
+/* Reads one byte of the file at OFS through HANDLE. */
+static char
+file_byte (int handle, int ofs)
+{
+  char c;
+
+  seek (handle, ofs);
+  if (read (handle, &c, 1) != 1)
+    fail ("read at offset %d failed", ofs);
+  return c;
+}
+
+void
+test_main (void)
+{
+  static const int touched[] = {3, 9, 10, 20, PAGES - 1};
+  static char buf[PAGE_SIZE];
+  size_t len = strlen (sample);
+  int handle, i, j;
+  pid_t child;
+
+  CHECK (create ("sparse.dat", FILE_SIZE), "create \"sparse.dat\"");
+  CHECK ((handle = open ("sparse.dat")) > 1, "open \"sparse.dat\"");
+  seek (handle, 20 * PAGE_SIZE);
+  CHECK (write (handle, sample, len) == (int) len, "write sample to page 20");
+  CHECK (mmap (ACTUAL, FILE_SIZE, 1 | MAP_AROUND (1), handle, 0) != MAP_FAILED,
+         "mmap \"sparse.dat\"");
+
+  /* Page 20 is only read.  The other touched pages are written,
+     one of them through a write that straddles pages 9 and 10,
+     and one at the last byte of the file in its partial page. */
+  if (memcmp (ACTUAL + 20 * PAGE_SIZE, sample, len))
+    fail ("read of mmap'd file reported bad data");
+  ACTUAL[3 * PAGE_SIZE + 7] = 'a';
+  memcpy (ACTUAL + 10 * PAGE_SIZE - 1, "bc", 2);
+  ACTUAL[FILE_SIZE - 1] = 'd';
+  if (ACTUAL[3 * PAGE_SIZE + 6] != 0 || ACTUAL[FILE_SIZE - 2] != 0)
+    fail ("untouched bytes of a touched page are not zero");
+
+  for (i = 0, j = 0; i < PAGES; i++)
+    {
+      bool expected = j < (int) (sizeof touched / sizeof *touched)
+                      && touched[j] == i;
+
+      if ((get_phys_addr (ACTUAL + i * PAGE_SIZE) != 0) != expected)
+        fail ("page %d is %sresident", i, expected ? "not " : "");
+      if (expected)
+        j++;
+    }
+  msg ("only the touched pages are resident");
+  munmap (ACTUAL);
+
+  CHECK (file_byte (handle, 3 * PAGE_SIZE + 7) == 'a'
+         && file_byte (handle, 10 * PAGE_SIZE - 1) == 'b'
+         && file_byte (handle, 10 * PAGE_SIZE) == 'c'
+         && file_byte (handle, FILE_SIZE - 1) == 'd',
+         "munmap wrote the written pages back");
+  seek (handle, 20 * PAGE_SIZE);
+  CHECK (read (handle, buf, len) == (int) len && !memcmp (buf, sample, len),
+         "page that was only read is unchanged");
+  CHECK (filesize (handle) == FILE_SIZE, "file size is unchanged");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      if (mmap (CHILD_MAP, 8 * PAGE_SIZE, 1 | MAP_AROUND (1), handle,
+                CHILD_OFS * PAGE_SIZE) == MAP_FAILED)
+        exit (1);
+      CHILD_MAP[0] = 'e';
+      CHILD_MAP[PAGE_SIZE] = 'f';
+      exit (get_phys_addr (CHILD_MAP + 2 * PAGE_SIZE) == 0 ? 0 : 2);
+    }
+  CHECK (wait (child) == 0, "child wrote two pages and exited");
+  CHECK (file_byte (handle, CHILD_OFS * PAGE_SIZE) == 'e'
+         && file_byte (handle, (CHILD_OFS + 1) * PAGE_SIZE) == 'f',
+         "exit wrote the child's pages back");
+  close (handle);
+}
@@ -0,0 +1,35 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+# Pages 3, 9, 10 and the last page are written through the parent's
+# mapping, and two pages through the child's.  Each must reach the
+# file exactly once, either when it is unmapped or earlier by flushd.
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($file) = grep (/^File: /, @output);
+my ($flush) = grep (/^Flush: /, @output);
+fail "missing File or Flush statistics\n" if !defined $file || !defined $flush;
+my ($written) = $file =~ /(\d+) written back/
+  or fail "malformed File statistics: $file\n";
+my ($flushed) = $flush =~ /^Flush: (\d+) pages written back/
+  or fail "malformed Flush statistics: $flush\n";
+fail "wrote back " . ($written + $flushed) . " pages, expected 6\n"
+  if $written + $flushed != 6;
+
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-sparse) begin
+(mmap-sparse) create "sparse.dat"
+(mmap-sparse) open "sparse.dat"
+(mmap-sparse) write sample to page 20
+(mmap-sparse) mmap "sparse.dat"
+(mmap-sparse) only the touched pages are resident
+(mmap-sparse) munmap wrote the written pages back
+(mmap-sparse) page that was only read is unchanged
+(mmap-sparse) file size is unchanged
+(mmap-sparse) child wrote two pages and exited
+(mmap-sparse) exit wrote the child's pages back
+(mmap-sparse) end
+EOF
+pass;
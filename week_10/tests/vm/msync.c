@@ -0,0 +1,45 @@
+/* Checks msync(): pages written through a mapping reach the
+   file before the mapping goes away, and msync() on an address
+   that is not mapped fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define ACTUAL ((char *) 0x10000000)
+
+void
+test_main (void)
+{
+  static char buf[PAGE_SIZE];
+  size_t len = strlen (sample);
+  void *map;
+  int handle, i;
+
+  CHECK (create ("msync.dat", 2 * PAGE_SIZE), "create \"msync.dat\"");
+  CHECK ((handle = open ("msync.dat")) > 1, "open \"msync.dat\"");
+  CHECK ((map = mmap (ACTUAL, 2 * PAGE_SIZE, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"msync.dat\"");
+  for (i = 0; i < 2; i++)
+    memcpy (ACTUAL + i * PAGE_SIZE, sample, len);
+  CHECK (msync (ACTUAL, 2 * PAGE_SIZE) == 0, "msync");
+
+  /* The file has the data while it is still mapped. */
+  for (i = 0; i < 2; i++)
+    {
+      seek (handle, i * PAGE_SIZE);
+      if (read (handle, buf, len) != (int) len)
+        fail ("read of page %d failed", i);
+      if (memcmp (buf, sample, len))
+        fail ("page %d was not written back", i);
+    }
+  msg ("file matches mapping");
+
+  CHECK (msync (ACTUAL + 2 * PAGE_SIZE, PAGE_SIZE) == -1,
+         "msync of unmapped page fails");
+  munmap (map);
+  close (handle);
+}
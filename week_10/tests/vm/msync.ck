@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(msync) begin
+(msync) create "msync.dat"
+(msync) open "msync.dat"
+(msync) mmap "msync.dat"
+(msync) msync
+(msync) file matches mapping
+(msync) msync of unmapped page fails
+(msync) end
+EOF
+pass;
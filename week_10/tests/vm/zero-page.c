@@ -0,0 +1,43 @@
+/* Checks that reading untouched BSS pages maps the shared zero
+   page instead of allocating a frame per page, and that the
+   first write to such a page gives it a private frame. */
+
+#include <string.h>
+#include <syscall.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 64
+
+static char sparse[PAGE_COUNT * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  void *zero, *pa0, *pa1;
+  size_t i;
+
+  /* Skip the first page, which may share a frame with .data. */
+  for (i = 1; i < PAGE_COUNT; i++)
+    if (sparse[i * PAGE_SIZE] != 0)
+      fail ("page %zu is not zero", i);
+  zero = get_phys_addr (&sparse[PAGE_SIZE]);
+  for (i = 2; i < PAGE_COUNT; i++)
+    if (get_phys_addr (&sparse[i * PAGE_SIZE]) != zero)
+      break;
+  CHECK (i == PAGE_COUNT, "read pages share one frame");
+
+  sparse[3 * PAGE_SIZE] = 'a';
+  sparse[5 * PAGE_SIZE] = 'b';
+  pa0 = get_phys_addr (&sparse[3 * PAGE_SIZE]);
+  pa1 = get_phys_addr (&sparse[5 * PAGE_SIZE]);
+  CHECK (pa0 != zero && pa1 != zero && pa0 != pa1,
+         "written pages get private frames");
+  CHECK (sparse[3 * PAGE_SIZE] == 'a' && sparse[5 * PAGE_SIZE] == 'b',
+         "written data is kept");
+  CHECK (sparse[4 * PAGE_SIZE] == 0 && get_phys_addr (&sparse[4 * PAGE_SIZE]) == zero,
+         "unwritten pages stay zero");
+}
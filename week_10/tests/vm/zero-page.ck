@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page) begin
+(zero-page) read pages share one frame
+(zero-page) written pages get private frames
+(zero-page) written data is kept
+(zero-page) unwritten pages stay zero
+(zero-page) end
+EOF
+pass;
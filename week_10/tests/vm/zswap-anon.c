@@ -0,0 +1,45 @@
+/* Writes an anonymous working set larger than memory whose pages
+   compress well, then reads it back.  Run with -zswap, every
+   evicted page should go to the compressed cache instead of the
+   swap disk; the .ck file checks the cache's counters in the
+   statistics printed at shutdown. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (16 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunks[CHUNK_SIZE];
+
+/* Each page holds its number in the first bytes and a run of one
+   byte after that, so that it compresses to a few dozen bytes but
+   no two pages are alike. */
+static void
+fill_page (char *page, size_t i)
+{
+  memset (page, 'a' + i % 26, PAGE_SIZE);
+  memcpy (page, &i, sizeof i);
+}
+
+void
+test_main (void)
+{
+  static char expected[PAGE_SIZE];
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    fill_page (big_chunks + i * PAGE_SIZE, i);
+  msg ("wrote %d pages", PAGE_COUNT);
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    {
+      fill_page (expected, i);
+      if (memcmp (big_chunks + i * PAGE_SIZE, expected, PAGE_SIZE))
+        fail ("page %zu has bad data", i);
+    }
+  msg ("all pages read back intact");
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+my ($stats) = grep (/^Zswap: /, @output);
+fail "missing Zswap statistics\n" if !defined $stats;
+my ($stored, $rejected, $hits, $writebacks)
+  = $stats =~ /^Zswap: (\d+) stored, (\d+) rejected, (\d+) hits, (\d+) writebacks/
+  or fail "malformed Zswap statistics: $stats\n";
+fail "no pages were stored in the compressed cache\n" if $stored == 0;
+fail "$rejected compressible pages were written to the swap disk\n"
+  if $rejected != 0;
+fail "$writebacks pages were written back although the cache had room\n"
+  if $writebacks != 0;
+fail "no pages were read back from the compressed cache\n" if $hits == 0;
+
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zswap-anon) begin
+(zswap-anon) wrote 4096 pages
+(zswap-anon) all pages read back intact
+(zswap-anon) end
+EOF
+pass;
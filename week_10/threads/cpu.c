@@ -0,0 +1,293 @@
+#include "threads/cpu.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/lapic.h"
+#include "devices/timer.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+#ifdef USERPROG
+#include "userprog/gdt.h"
+#include "userprog/syscall.h"
+#include "userprog/tss.h"
+#endif
+
+/* Multiprocessor support.
+
+   The BSP finds the other CPUs in the BIOS's MP configuration
+   table and starts each one in turn through its local APIC with
+   an INIT IPI followed by startup IPIs that point at the code in
+   ap-start.S.  An application processor switches to the kernel's
+   page tables, loads the IDT, points its GS base at its own
+   struct cpu, enables its local APIC and reports in.  Once the
+   BSP has counted it in cpu_cnt, it turns the stack it was
+   started on into its idle thread, loads its own GDT, TSS and
+   syscall MSRs, starts a periodic timer and schedules threads
+   like any other CPU.
+
+   All CPUs share one interrupt lock (threads/interrupt.c), so
+   kernel code that runs with interrupts off still runs on one
+   CPU at a time.  Everything else, including user programs, runs
+   in parallel. */
+
+#define MSR_GS_BASE 0xc0000101
+#define MSR_KERNEL_GS_BASE 0xc0000102   /* Swapped in by swapgs. */
+
+/* syscall-entry.S finds these at fixed offsets. */
+_Static_assert (__builtin_offsetof (struct cpu, tss) == CPU_TSS,
+		"CPU_TSS");
+_Static_assert (__builtin_offsetof (struct cpu, scratch) == CPU_SCRATCH,
+		"CPU_SCRATCH");
+
+struct cpu cpus[CPU_MAX];
+int cpu_cnt = 1;
+
+/* ap-start.S. */
+extern char ap_trampoline[], ap_trampoline_end[];
+extern uint32_t ap_cr3;
+extern uint64_t ap_stack;
+extern uint64_t boot_pml4e[];
+
+/* CPU being started by smp_init(). */
+static struct cpu *volatile ap_booting;
+
+void ap_main (void) NO_RETURN;
+static intr_handler_func resched_interrupt;
+
+/* Points the running CPU's GS base at C.  User mode starts with
+   a GS base of 0, swapped in by swapgs on the way out. */
+static void
+cpu_load (struct cpu *c) {
+	c->self = c;
+	write_msr (MSR_GS_BASE, (uint64_t) c);
+	write_msr (MSR_KERNEL_GS_BASE, 0);
+}
+
+/* Sets up the BSP's per-CPU data and takes the interrupt lock,
+   since the BSP boots with interrupts off.  Must run before
+   anything calls cpu_current(), that is, before thread_init(). */
+void
+cpu_init_bsp (void) {
+	cpus[0].id = 0;
+	cpu_load (&cpus[0]);
+	intr_start_cpu ();
+}
+
+/* MP floating pointer structure, see [MP] 4.1. */
+struct mp_fp {
+	char signature[4];          /* "_MP_". */
+	uint32_t config;            /* Physical address of struct mp_config. */
+	uint8_t length;             /* In 16-byte units. */
+	uint8_t spec_rev;
+	uint8_t checksum;
+	uint8_t type;
+	uint8_t features[4];
+} __attribute__((packed));
+
+/* MP configuration table header, see [MP] 4.2. */
+struct mp_config {
+	char signature[4];          /* "PCMP". */
+	uint16_t length;
+	uint8_t spec_rev;
+	uint8_t checksum;
+	char oem_id[8];
+	char product_id[12];
+	uint32_t oem_table;
+	uint16_t oem_length;
+	uint16_t entry_cnt;
+	uint32_t lapic_addr;
+	uint16_t ext_length;
+	uint8_t ext_checksum;
+	uint8_t reserved;
+} __attribute__((packed));
+
+/* Processor entry of the configuration table, see [MP] 4.3.1.
+   The other entry types are 8 bytes long. */
+struct mp_proc {
+	uint8_t type;               /* MP_PROC. */
+	uint8_t apic_id;
+	uint8_t apic_version;
+	uint8_t flags;              /* MP_PROC_*. */
+	uint32_t signature;
+	uint32_t features;
+	uint8_t reserved[8];
+} __attribute__((packed));
+
+#define MP_PROC 0
+#define MP_PROC_ENABLED 0x01
+#define MP_PROC_BSP 0x02
+
+static uint8_t
+checksum (const void *p_, size_t size) {
+	const uint8_t *p = p_;
+	uint8_t sum = 0;
+
+	while (size-- > 0)
+		sum += *p++;
+	return sum;
+}
+
+/* Looks for the MP floating pointer in SIZE bytes at physical
+   address PA. */
+static struct mp_fp *
+mp_search (uint64_t pa, size_t size) {
+	uint8_t *p = ptov (pa);
+
+	for (size_t ofs = 0; ofs + sizeof (struct mp_fp) <= size; ofs += 16) {
+		struct mp_fp *fp = (struct mp_fp *) (p + ofs);
+		if (!memcmp (fp->signature, "_MP_", 4)
+				&& checksum (fp, fp->length * 16) == 0)
+			return fp;
+	}
+	return NULL;
+}
+
+/* Returns the MP configuration table, or a null pointer if the
+   BIOS did not provide one.  The floating pointer is in the
+   first kB of the EBDA, the last kB of base memory, or the BIOS
+   ROM. */
+static struct mp_config *
+mp_config (void) {
+	uint64_t ebda = (uint64_t) *(uint16_t *) ptov (0x40e) << 4;
+	struct mp_fp *fp = NULL;
+	struct mp_config *conf;
+
+	if (ebda != 0)
+		fp = mp_search (ebda, 1024);
+	if (fp == NULL)
+		fp = mp_search (0x9fc00, 1024);
+	if (fp == NULL)
+		fp = mp_search (0xf0000, 0x10000);
+	if (fp == NULL || fp->config == 0)
+		return NULL;
+
+	conf = ptov (fp->config);
+	if (memcmp (conf->signature, "PCMP", 4)
+			|| checksum (conf, conf->length) != 0)
+		return NULL;
+	return conf;
+}
+
+/* Starts C's CPU and waits up to 100 ms for it to reach
+   ap_main().  Returns true if it did.  The stack page becomes the
+   CPU's idle thread (thread_init_ap()).  Its TSS is allocated
+   here too, because the idle thread must not block on the
+   allocator's lock. */
+static bool
+start_ap (struct cpu *c) {
+	uint8_t *trampoline = ptov (AP_TRAMPOLINE);
+	uint8_t *stack = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+
+	runq_init (&c->runq);
+#ifdef USERPROG
+	if (c->tss == NULL)
+		c->tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+#endif
+
+	/* The variables live inside the copied trampoline. */
+	*(uint32_t *) (trampoline + ((char *) &ap_cr3 - ap_trampoline))
+		= vtop (boot_pml4e);
+	*(uint64_t *) (trampoline + ((char *) &ap_stack - ap_trampoline))
+		= (uint64_t) stack + PGSIZE;
+	ap_booting = c;
+
+	/* INIT, then startup IPIs as in [MP] B.4. */
+	lapic_send_init (c->apic_id);
+	timer_msleep (10);
+	for (int i = 0; i < 2 && !c->started; i++) {
+		lapic_send_startup (c->apic_id, AP_TRAMPOLINE);
+		timer_usleep (200);
+	}
+	for (int i = 0; i < 100 && !c->started; i++)
+		timer_msleep (1);
+
+	if (!c->started)
+		palloc_free_page (stack);
+	return c->started;
+}
+
+/* Finds and starts the application processors.  Needs the
+   local APIC timer, which drives their time slices, and a
+   working timer_msleep(), so it must run after
+   timer_lapic_init(). */
+void
+smp_init (void) {
+	struct mp_config *conf = mp_config ();
+	uint8_t *entry;
+	int found = 1;
+
+	if (conf == NULL || !timer_lapic_active () || !lapic_init ())
+		return;
+	intr_register_ext (LAPIC_RESCHED_VEC, resched_interrupt, "Reschedule IPI");
+	cpus[0].apic_id = lapic_id ();
+	memcpy (ptov (AP_TRAMPOLINE), ap_trampoline,
+			ap_trampoline_end - ap_trampoline);
+
+	entry = (uint8_t *) (conf + 1);
+	for (int i = 0; i < conf->entry_cnt; i++) {
+		struct mp_proc *proc = (struct mp_proc *) entry;
+
+		if (proc->type != MP_PROC) {
+			entry += 8;
+			continue;
+		}
+		entry += sizeof *proc;
+		if (!(proc->flags & MP_PROC_ENABLED) || (proc->flags & MP_PROC_BSP)
+				|| proc->apic_id == cpus[0].apic_id)
+			continue;
+		found++;
+		if (cpu_cnt == CPU_MAX)
+			continue;
+
+		cpus[cpu_cnt].id = cpu_cnt;
+		cpus[cpu_cnt].apic_id = proc->apic_id;
+		/* Lets the AP go on to schedule threads (see ap_main()). */
+		if (start_ap (&cpus[cpu_cnt]))
+			__atomic_store_n (&cpu_cnt, cpu_cnt + 1, __ATOMIC_RELEASE);
+	}
+	printf ("SMP: %d of %d CPUs online.\n", cpu_cnt, found);
+}
+
+/* Entered by each application processor from ap-start.S, on the
+   loader's page tables and the stack smp_init() gave it. */
+void
+ap_main (void) {
+	struct cpu *c = ap_booting;
+
+	lcr3 (vtop (base_pml4));
+	cpu_load (c);
+	if (pcid_enabled)
+		lcr4 (rcr4 () | CR4_PCIDE);
+	intr_load_idt ();
+	lapic_enable ();
+	__atomic_store_n (&c->started, true, __ATOMIC_RELEASE);
+
+	/* Wait for smp_init() to count us in before touching anything
+	   shared: until then other CPUs' TLB shootdowns and wakeups
+	   skip this one. */
+	while (c->id >= __atomic_load_n (&cpu_cnt, __ATOMIC_ACQUIRE))
+		asm volatile ("pause");
+
+	intr_start_cpu ();
+	thread_init_ap ();
+#ifdef USERPROG
+	tss_init ();
+	gdt_init ();
+	ltr (SEL_TSS);
+	syscall_init_cpu ();
+#endif
+	timer_init_ap ();
+	thread_start_ap ();
+}
+
+/* LAPIC_RESCHED_VEC: another CPU has made a thread ready that
+   this one should run (thread_unblock()). */
+static void
+resched_interrupt (struct intr_frame *f UNUSED) {
+	intr_yield_on_return ();
+}
@@ -13,6 +13,7 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
@@ -31,6 +32,8 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/evict.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
@@ -49,6 +52,15 @@ static bool format_filesys;
 /* -q: Power off after kernel tasks complete? */
 bool power_off_when_done;
 
+/* -nopcid: Flush the whole TLB on every address space switch? */
+static bool no_pcid;
+
+/* -nolapic: Keep the periodic PIT tick. */
+static bool no_lapic;
+
+/* -nosmp: Leave the application processors halted. */
+static bool no_smp;
+
 bool thread_tests;
 
 static void bss_init (void);
@@ -73,6 +85,7 @@ main (void) {
 	/* Clear BSS and get machine's RAM size. */
 	/*메모리 할당 가져오기 및 초기화*/ // 데이터 세그먼트
 	bss_init ();
+	cpu_init_bsp ();	// GS base -> cpus[0], thread_init보다 먼저
 
 	/* Break command line into arguments and parse options. */
 	argv = read_command_line (); //kernel command line을 읽어와서 arguments로 나눈다.
@@ -92,6 +105,8 @@ main (void) {
 	//mem_end : 268304384
 	malloc_init ();				// 사용자 메모리 할당(malloc)이 가능하게 설정
 	paging_init (mem_end);		// loader.S 에서 구성했던 페이지 테이블을 다시 구성
+	if (!no_pcid)
+		pcid_init ();			// CPU가 지원하면 주소 공간마다 PCID를 쓴다
 	
 #ifdef USERPROG
 	tss_init ();
@@ -111,6 +126,10 @@ main (void) {
 	thread_start ();		//우선 가장 실행 우선순위가 낮은 idle 이라는 thread를 생성하여 동작 시키고 인터럽트를 활성화시킨다. 
 	serial_init_queue ();	//시리얼로부터 인터럽트를 받아 커널을 제어할 수 있도록 한다.
 	timer_calibrate ();		//정확한 시간 측정을 위해 timer를 보정한다.  
+	if (!no_lapic)
+		timer_lapic_init ();	// one-shot local APIC 타이머로 바꾼다 (idle일 때 tick을 멈춤)
+	if (!no_smp)
+		smp_init ();			// 다른 CPU들을 깨운다
 
 #ifdef FILESYS
 	/* Initialize file system. */
@@ -230,11 +249,39 @@ parse_options (char **argv) {
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-nopcid"))
+			no_pcid = true;
+		else if (!strcmp (name, "-nolapic"))
+			no_lapic = true;
+		else if (!strcmp (name, "-nosmp"))
+			no_smp = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-vmpolicy")) {
+			if (value == NULL || !evict_policy_select (value))
+				PANIC ("unknown page replacement policy `%s'", value);
+		}
+		else if (!strcmp (name, "-vmlow"))
+			vm_reclaim_low = atoi (value);
+		else if (!strcmp (name, "-vmhigh"))
+			vm_reclaim_high = atoi (value);
+		else if (!strcmp (name, "-zswap"))
+			zswap_limit = (size_t) atoi (value) * 1024;
+		else if (!strcmp (name, "-flush"))
+			vm_flush_interval = atoi (value);
+		else if (!strcmp (name, "-populate"))
+			vm_populate_exec = true;
+		else if (!strcmp (name, "-nohuge"))
+			vm_huge_pages = false;
+		else if (!strcmp (name, "-ksm"))
+			vm_ksm_pages = atoi (value);
+		else if (!strcmp (name, "-faround"))
+			file_fault_around = atoi (value) > 0 ? atoi (value) : 1;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -338,8 +385,27 @@ usage (void) {
 			"  -f                 Format file system disk during startup.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -nopcid            Do not tag TLB entries with address space IDs.\n"
+			"  -nolapic           Keep the periodic PIT tick instead of the\n"
+			"                     one-shot local APIC timer.\n"
+			"  -nosmp             Do not start the other CPUs.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -vmpolicy=NAME     Use page replacement policy NAME\n"
+			"                     (clock, wsclock, 2q, arc).\n"
+			"  -vmlow=COUNT       Start background reclaim below COUNT free frames.\n"
+			"  -vmhigh=COUNT      Stop background reclaim at COUNT free frames.\n"
+			"  -zswap=KB          Cap the compressed swap cache at KB (0 disables).\n"
+			"  -faround=COUNT     Map up to COUNT file pages per page fault.\n"
+			"  -flush=TICKS       Write dirty mmap pages back every TICKS ticks\n"
+			"                     (0 disables).\n"
+			"  -populate          Read executable segments in at exec time\n"
+			"                     instead of on first access.\n"
+			"  -nohuge            Map anonymous regions with 4 kB pages only.\n"
+			"  -ksm=COUNT         Merge identical anonymous pages, scanning\n"
+			"                     COUNT frames every 10 ticks.\n"
 #endif
 			);
 	power_off ();
@@ -366,6 +432,7 @@ static void
 print_stats (void) {
 	timer_print_stats ();
 	thread_print_stats ();
+	pcid_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
 #endif
@@ -374,4 +441,7 @@ print_stats (void) {
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
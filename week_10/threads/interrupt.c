@@ -3,12 +3,15 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
+#include "threads/spinlock.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
 #include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
@@ -99,13 +102,36 @@ static const char *intr_names[INTR_CNT];
    pre-empted.  Handlers for external interrupts also may not
    sleep, although they may invoke intr_yield_on_return() to
    request that a new process be scheduled just before the
-   interrupt returns. */
-static bool in_external_intr;   /* Are we processing an external interrupt? */
-static bool yield_on_return;    /* Should we yield on interrupt return? */
+   interrupt returns.  Whether we are processing one, and whether
+   to yield on return, is per-CPU state in struct cpu. */
+
+/* Interrupt lock.
+
+   On one CPU, turning interrupts off is enough to keep other
+   threads away from what a piece of kernel code is working on:
+   the semaphores, the run queues, the sleep heap and everything
+   else the kernel protects with intr_disable().  With several
+   CPUs it is not, so a CPU also holds this spinlock whenever it
+   runs kernel code with interrupts off.  intr_disable() takes it
+   and intr_enable() releases it.  Interrupt entry takes it if the
+   interrupted code had interrupts on, and it is released again
+   just before the kernel turns them back on by leaving with
+   iretq or sysretq, or by halting with `sti; hlt' (see
+   intr_disable_unlocked()).
+
+   Threads are switched with interrupts off, so the lock belongs
+   to the CPU rather than to a thread: the thread switched to
+   releases it when it turns interrupts back on.
+
+   A CPU waiting for the lock keeps answering TLB shootdowns,
+   because the CPU holding it may be waiting for one
+   (threads/mmu.c). */
+static struct spinlock intr_lock;
 
 /* Programmable Interrupt Controller helpers. */
 static void pic_init (void);
 static void pic_end_of_interrupt (int irq);
+static void intr_lock_acquire (void);
 
 /* Interrupt handlers. */
 void intr_handler (struct intr_frame *args);
@@ -139,6 +165,9 @@ intr_enable (void) {
 	enum intr_level old_level = intr_get_level ();
 	ASSERT (!intr_context ());
 
+	if (old_level == INTR_OFF)
+		spinlock_release (&intr_lock);
+
 	/* Enable interrupts by setting the interrupt flag.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
@@ -158,10 +187,43 @@ intr_disable (void) {
 	   See [IA32-v2b] "CLI" and [IA32-v3a] 5.8.1 "Masking Maskable
 	   Hardware Interrupts". */
 	asm volatile ("cli" : : : "memory");
+	if (old_level == INTR_ON)
+		intr_lock_acquire ();
 
 	return old_level;
 }
 
+/* Turns interrupts off but leaves the interrupt lock free, for
+   code about to turn them back on with the instruction that
+   leaves the kernel or halts the CPU: iretq, sysretq or
+   `sti; hlt'.  Nothing in between may rely on the lock. */
+void
+intr_disable_unlocked (void) {
+	if (intr_get_level () == INTR_ON)
+		asm volatile ("cli" : : : "memory");
+	else
+		spinlock_release (&intr_lock);
+}
+
+/* Takes the interrupt lock for the running CPU, which is starting
+   up with interrupts off: the BSP from cpu_init_bsp(), each
+   application processor from ap_main(). */
+void
+intr_start_cpu (void) {
+	ASSERT (intr_get_level () == INTR_OFF);
+	intr_lock_acquire ();
+}
+
+/* Spins until this CPU holds the interrupt lock.  Interrupts
+   must be off. */
+static void
+intr_lock_acquire (void) {
+	while (!spinlock_try_acquire (&intr_lock)) {
+		tlb_shootdown_handle ();
+		asm volatile ("pause");
+	}
+}
+
 /* Initializes the interrupt system. */
 void
 intr_init (void) {
@@ -182,7 +244,7 @@ intr_init (void) {
 #endif
 
 	/* Load IDT register. */
-	lidt(&idt_desc);
+	intr_load_idt ();
 
 	/* Initialize intr_names. */
 	intr_names[0] = "#DE Divide Error";
@@ -206,6 +268,13 @@ intr_init (void) {
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
 }
 
+/* Loads the IDT on the running CPU.  Application processors
+   share the BSP's IDT. */
+void
+intr_load_idt (void) {
+	lidt(&idt_desc);
+}
+
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
    privilege level DPL.  Names the interrupt NAME for debugging
    purposes.  The interrupt handler will be invoked with
@@ -226,11 +295,12 @@ register_handler (uint8_t vec_no, int dpl, enum intr_level level,
 
 /* Registers external interrupt VEC_NO to invoke HANDLER, which
    is named NAME for debugging purposes.  The handler will
-   execute with interrupts disabled. */
+   execute with interrupts disabled.  Vectors 0x20...0x2f come
+   from the PICs and 0x30...0x3f from the local APIC. */
 void
 intr_register_ext (uint8_t vec_no, intr_handler_func *handler,
 		const char *name) {
-	ASSERT (vec_no >= 0x20 && vec_no <= 0x2f);
+	ASSERT (vec_no >= 0x20 && vec_no <= 0x3f);
 	register_handler (vec_no, 0, INTR_OFF, handler, name);
 }
 
@@ -251,14 +321,14 @@ void
 intr_register_int (uint8_t vec_no, int dpl, enum intr_level level,
 		intr_handler_func *handler, const char *name)
 {
-	ASSERT (vec_no < 0x20 || vec_no > 0x2f);
+	ASSERT (vec_no < 0x20 || vec_no > 0x3f);
 	register_handler (vec_no, dpl, level, handler, name);
 }
 
 /* 외부 인터럽트를 처리하는 동안 true를 반환하고 다른 모든 시간에는 false를 반환합니다. */
 bool
 intr_context (void) {
-	return in_external_intr;
+	return cpu_current ()->in_external_intr;
 }
 
 /* During processing of an external interrupt, directs the
@@ -268,7 +338,7 @@ intr_context (void) {
 void
 intr_yield_on_return (void) {
 	ASSERT (intr_context ());
-	yield_on_return = true;
+	cpu_current ()->yield_on_return = true;
 }
 
 /* 8259A Programmable Interrupt Controller. */
@@ -335,24 +405,38 @@ intr_handler (struct intr_frame *frame) {
 	bool external;
 	intr_handler_func *handler;
 
+	/* Answered without the interrupt lock, which the CPU asking
+	   for the shootdown may hold while it waits. */
+	if (frame->vec_no == LAPIC_TLB_VEC) {
+		tlb_shootdown_handle ();
+		lapic_eoi ();
+		return;
+	}
+
+	/* Code interrupted with interrupts off already holds the
+	   interrupt lock. */
+	if (frame->eflags & FLAG_IF)
+		intr_lock_acquire ();
+
 	/* External interrupts are special.
 	   We only handle one at a time (so interrupts must be off)
 	   and they need to be acknowledged on the PIC (see below).
 	   An external interrupt handler cannot sleep. */
-	external = frame->vec_no >= 0x20 && frame->vec_no < 0x30;
+	external = frame->vec_no >= 0x20 && frame->vec_no < 0x40;
 	if (external) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (!intr_context ());
 
-		in_external_intr = true;
-		yield_on_return = false;
+		cpu_current ()->in_external_intr = true;
+		cpu_current ()->yield_on_return = false;
 	}
 
 	/* Invoke the interrupt's handler. */
 	handler = intr_handlers[frame->vec_no];
 	if (handler != NULL)
 		handler (frame);
-	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f) {
+	else if (frame->vec_no == 0x27 || frame->vec_no == 0x2f
+			|| frame->vec_no == LAPIC_SPURIOUS_VEC) {
 		/* There is no handler, but this interrupt can trigger
 		   spuriously due to a hardware fault or hardware race
 		   condition.  Ignore it. */
@@ -368,12 +452,22 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_get_level () == INTR_OFF);
 		ASSERT (intr_context ());
 
-		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
+		cpu_current ()->in_external_intr = false;
+		if (frame->vec_no < 0x30)
+			pic_end_of_interrupt (frame->vec_no);
+		else
+			lapic_eoi ();
 
-		if (yield_on_return)
+		if (cpu_current ()->yield_on_return)
 			thread_yield ();
 	}
+
+	/* Return to the interrupted code with the lock as it had it.
+	   The handler may have turned interrupts on meanwhile. */
+	if (frame->eflags & FLAG_IF)
+		intr_disable_unlocked ();
+	else
+		intr_disable ();
 }
 
 /* Dumps interrupt frame F to the console, for debugging. */
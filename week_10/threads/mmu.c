@@ -1,13 +1,206 @@
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
+#include "devices/lapic.h"
 #include "intrinsic.h"
 
+/* Process-context identifiers (PCIDs).
+ *
+ * With CR4.PCIDE set, the low 12 bits of CR3 name the active
+ * address space and TLB entries are tagged with the PCID they
+ * were loaded under.  Loading CR3 with CR3_NOFLUSH keeps them, so
+ * a process that is switched back in finds its translations
+ * still cached instead of refilling the TLB from scratch.
+ *
+ * PCID 0 belongs to base_pml4.  User page tables are given one
+ * of PCID_SLOTS others when activated, taking the least recently
+ * activated slot once all are in use; the first activation with
+ * a new slot flushes what the previous owner left behind.
+ * invlpg only reaches the active PCID, so a page table that
+ * changes while it is not active has its slot marked stale and
+ * is flushed on its next activation instead.  Every CPU has its
+ * own TLB, so staleness is tracked per CPU.  Slots are updated
+ * with interrupts off.
+ *
+ * invlpg also only reaches the running CPU.  When a page table
+ * that another CPU has active changes, tlb_invalidate() sends
+ * that CPU a LAPIC_TLB_VEC interrupt and waits until it has
+ * invalidated the address too (a TLB shootdown). */
+#define PCID_SLOTS 16
+#define CPUID_1_ECX_PCID (1 << 17)
+
+struct pcid_slot {
+	uint64_t *pml4;         /* Owner, or a null pointer if free. */
+	uint64_t last_used;     /* pcid_clock at last activation, 0 if free. */
+	uint32_t stale;         /* Bit i: CPU i's TLB may hold stale entries. */
+};
+
+bool pcid_enabled;
+static struct pcid_slot pcid_slots[PCID_SLOTS];	/* Slot i is PCID i + 1. */
+static uint64_t pcid_clock;
+
+/* Statistics. */
+static long long pcid_keep_cnt;         /* Switches that kept the TLB. */
+static long long pcid_flush_cnt;        /* Switches that flushed it. */
+static long long pcid_recycle_cnt;      /* Slots taken from another pml4. */
+
+static struct pcid_slot *
+pcid_find (uint64_t *pml4) {
+	for (struct pcid_slot *s = pcid_slots; s < pcid_slots + PCID_SLOTS; s++)
+		if (s->pml4 == pml4)
+			return s;
+	return NULL;
+}
+
+/* Returns the PCID bits of CR3 for activating PML4 on CPU
+ * CPU_ID, with CR3_NOFLUSH unless that CPU's TLB may hold stale
+ * entries for it. */
+static uint64_t
+pcid_assign (uint64_t *pml4, int cpu_id) {
+	struct pcid_slot *s = pcid_find (pml4);
+	uint32_t bit = 1u << cpu_id;
+	bool flush;
+
+	if (s == NULL) {
+		s = pcid_slots;
+		for (struct pcid_slot *t = pcid_slots; t < pcid_slots + PCID_SLOTS; t++)
+			if (t->last_used < s->last_used)
+				s = t;
+		if (s->pml4 != NULL)
+			pcid_recycle_cnt++;
+		s->pml4 = pml4;
+		s->stale = UINT32_MAX;
+	}
+	flush = (s->stale & bit) != 0;
+	s->stale &= ~bit;
+	s->last_used = ++pcid_clock;
+	if (flush)
+		pcid_flush_cnt++;
+	else
+		pcid_keep_cnt++;
+	return (s - pcid_slots + 1) | (flush ? 0 : CR3_NOFLUSH);
+}
+
+/* Marks PML4's PCID, if it has one, as needing a flush on every
+ * CPU except those in KEEP. */
+static void
+pcid_stale (uint64_t *pml4, uint32_t keep) {
+	enum intr_level old_level = intr_disable ();
+	struct pcid_slot *s = pcid_find (pml4);
+
+	if (s != NULL)
+		s->stale |= ~keep;
+	intr_set_level (old_level);
+}
+
+/* Gives up PML4's PCID, if it has one, because PML4 is about to
+ * be freed and its page could become another page table. */
+static void
+pcid_release (uint64_t *pml4) {
+	enum intr_level old_level = intr_disable ();
+	struct pcid_slot *s = pcid_find (pml4);
+
+	if (s != NULL) {
+		s->pml4 = NULL;
+		s->last_used = 0;
+	}
+	intr_set_level (old_level);
+}
+
+/* TLB shootdown in progress.  Only the holder of the interrupt
+ * lock sends one, so there is never more than one. */
+static struct {
+	uint64_t *pml4;
+	uint64_t va;
+	uint32_t pending;       /* Bit i: CPU i has yet to invalidate. */
+} shootdown;
+
+/* Has every CPU in CPU_MASK invalidate VA if it has PML4 active,
+ * and waits until they all have. */
+static void
+tlb_shootdown (uint32_t cpu_mask, uint64_t *pml4, uint64_t va) {
+	shootdown.pml4 = pml4;
+	shootdown.va = va;
+	__atomic_store_n (&shootdown.pending, cpu_mask, __ATOMIC_RELEASE);
+	for (int i = 0; i < cpu_cnt; i++)
+		if (cpu_mask & (1u << i))
+			lapic_send_ipi (cpus[i].apic_id, LAPIC_TLB_VEC);
+	while (__atomic_load_n (&shootdown.pending, __ATOMIC_ACQUIRE) != 0)
+		asm volatile ("pause");
+}
+
+/* Answers a TLB shootdown aimed at the running CPU, if any.
+ * Called on LAPIC_TLB_VEC and by CPUs spinning on the interrupt
+ * lock, which the CPU waiting for the answer holds. */
+void
+tlb_shootdown_handle (void) {
+	uint32_t bit = 1u << cpu_current ()->id;
+
+	if (!(__atomic_load_n (&shootdown.pending, __ATOMIC_ACQUIRE) & bit))
+		return;
+	if (PTE_ADDR (rcr3 ()) == vtop (shootdown.pml4))
+		invlpg (shootdown.va);
+	__atomic_fetch_and (&shootdown.pending, ~bit, __ATOMIC_RELEASE);
+}
+
+/* Invalidates any TLB entry for user address VA in PML4, which
+ * is cached under PML4's PCID even while PML4 is not active, on
+ * every CPU. */
+static void
+tlb_invalidate (uint64_t *pml4, uint64_t va) {
+	enum intr_level old_level = intr_disable ();
+	struct cpu *c = cpu_current ();
+	uint64_t cr3 = rcr3 ();
+	uint32_t others = 0, keep = 0;
+
+	if (PTE_ADDR (cr3) == vtop (pml4)) {
+		invlpg (va);
+		/* Active here under its own PCID: this CPU's TLB is clean. */
+		if ((cr3 & CR3_PCID_MASK) != 0)
+			keep = 1u << c->id;
+	}
+	for (int i = 0; i < cpu_cnt; i++)
+		if (i != c->id && cpus[i].pml4 == pml4)
+			others |= 1u << i;
+	if (others != 0)
+		tlb_shootdown (others, pml4, va);
+	pcid_stale (pml4, keep);
+	intr_set_level (old_level);
+}
+
+/* Page tables set aside by pml4_set_huge_page(), one for each
+ * large page mapped, so that splitting a large page back into
+ * 4 kB pages never has to allocate memory.  Linked through their
+ * first word. */
+static uint64_t *pt_reserve;
+
+static void
+pt_reserve_push (uint64_t *pt) {
+	enum intr_level old_level = intr_disable ();
+	*(uint64_t **) pt = pt_reserve;
+	pt_reserve = pt;
+	intr_set_level (old_level);
+}
+
+static uint64_t *
+pt_reserve_pop (void) {
+	enum intr_level old_level = intr_disable ();
+	uint64_t *pt = pt_reserve;
+
+	ASSERT (pt != NULL);
+	pt_reserve = *(uint64_t **) pt;
+	intr_set_level (old_level);
+	return pt;
+}
+
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
@@ -23,6 +216,11 @@ pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 			} else
 				return NULL;
 		}
+		/* A large page has no page table.  Its PDE has the same
+		 * flag bits as a PTE, so lookups get the PDE itself.
+		 * Callers that change the entry split it first. */
+		if (pdp[idx] & PTE_PS)
+			return &pdp[idx];
 		return (uint64_t *) ptov (PTE_ADDR (pdp[idx]) + 8 * PTX (va));
 	}
 	return NULL;
@@ -88,6 +286,51 @@ pml4e_walk (uint64_t *pml4e, const uint64_t va, int create) {
 	return pte;
 }
 
+/* Returns the page directory entry for VA in PML4, or a null
+ * pointer if there is no page directory for VA. */
+static uint64_t *
+pde_lookup (uint64_t *pml4, uint64_t va) {
+	uint64_t *pdpe, *pde;
+
+	if (!(pml4[PML4 (va)] & PTE_P))
+		return NULL;
+	pdpe = ptov (PTE_ADDR (pml4[PML4 (va)]));
+	if (!(pdpe[PDPE (va)] & PTE_P))
+		return NULL;
+	pde = ptov (PTE_ADDR (pdpe[PDPE (va)]));
+	return &pde[PDX (va)];
+}
+
+static bool
+pde_is_huge (const uint64_t *pde) {
+	return pde != NULL && (*pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS);
+}
+
+/* If VA is mapped by a large page in PML4, replaces the large
+ * page with a page table that maps the same frames with the same
+ * permissions and accessed and dirty bits, so that the entry for
+ * VA alone can be changed.  The page table comes from the
+ * reserve, so this cannot fail. */
+static void
+huge_split (uint64_t *pml4, uint64_t va) {
+	uint64_t *pde = pde_lookup (pml4, va);
+	uint64_t *pt, pa, flags;
+
+	if (!pde_is_huge (pde))
+		return;
+
+	pt = pt_reserve_pop ();
+	pa = PTE_ADDR (*pde);
+	flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+	for (unsigned i = 0; i < HPG_CNT; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+
+	/* The CPU must not keep setting accessed and dirty bits
+	 * through a cached large-page translation. */
+	tlb_invalidate (pml4, (uint64_t) hpg_round_down (va));
+}
+
 /* Creates a new page map level 4 (pml4) has mappings for kernel
  * virtual addresses, but none for user virtual addresses.
  * Returns the new page directory, or a null pointer if memory
@@ -122,6 +365,9 @@ pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
+		/* Large pages have no PTEs to visit. */
+		if (pdp[i] & PTE_PS)
+			continue;
 		if (((uint64_t) pte) & PTE_P)
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
@@ -169,7 +415,11 @@ static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		/* The frames of a large page belong to the VM; only its
+		 * reserved page table is freed here. */
+		if (pde_is_huge (&pdp[i]))
+			palloc_free_page (pt_reserve_pop ());
+		else if (((uint64_t) pte) & PTE_P)
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -196,6 +446,7 @@ pml4_destroy (uint64_t *pml4) {
 	uint64_t *pdpe = ptov ((uint64_t *) pml4[0]);
 	if (((uint64_t) pdpe) & PTE_P)
 		pdpe_destroy ((void *) PTE_ADDR (pdpe));
+	pcid_release (pml4);
 	palloc_free_page ((void *) pml4);
 }
 
@@ -203,9 +454,56 @@ pml4_destroy (uint64_t *pml4) {
  * register. */
 /* 페이지 디렉토리 PD를 CPU의 페이지 디렉토리 베이스로 로드
   * 등록하다. */
+/* With PCIDs, the TLB entries of other address spaces survive
+ * the switch. */
+/* The CPU's active page table is recorded in its struct cpu so
+ * that tlb_invalidate() knows whom to shoot down. */
 void
 pml4_activate (uint64_t *pml4) {
-	lcr3 (vtop (pml4 ? pml4 : base_pml4));
+	enum intr_level old_level;
+	struct cpu *c;
+
+	if (pml4 == NULL)
+		pml4 = base_pml4;
+
+	old_level = intr_disable ();
+	c = cpu_current ();
+	c->pml4 = pml4;
+	if (!pcid_enabled) {
+		if (pml4 != base_pml4)
+			c->pcid0_dirty = true;
+		lcr3 (vtop (pml4));
+	} else if (pml4 == base_pml4) {
+		/* base_pml4 never changes, but user page tables may have
+		 * run under PCID 0 while PCIDs were off. */
+		lcr3 (vtop (pml4) | (c->pcid0_dirty ? 0 : CR3_NOFLUSH));
+		c->pcid0_dirty = false;
+	} else
+		lcr3 (vtop (pml4) | pcid_assign (pml4, c->id));
+	intr_set_level (old_level);
+}
+
+/* Turns on PCIDs if the CPU supports them.  Must be called while
+ * base_pml4 is active with PCID 0, as after paging_init(). */
+void
+pcid_init (void) {
+	uint32_t eax, ebx, ecx, edx;
+
+	cpuid (1, &eax, &ebx, &ecx, &edx);
+	if (!(ecx & CPUID_1_ECX_PCID))
+		return;
+	ASSERT ((rcr3 () & CR3_PCID_MASK) == 0);
+	lcr4 (rcr4 () | CR4_PCIDE);
+	pcid_enabled = true;
+}
+
+/* Prints address space switch statistics. */
+void
+pcid_print_stats (void) {
+	printf ("PCID: %s, %lld switches kept the TLB, %lld flushed, "
+			"%lld identifiers recycled\n",
+			pcid_enabled ? "on" : "off",
+			pcid_keep_cnt, pcid_flush_cnt, pcid_recycle_cnt);
 }
 
 /* Looks up the physical address that corresponds to user virtual
@@ -220,8 +518,12 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		/* PTE_PS is never set in a PTE, so this is a large page's PDE. */
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte)) + ((uint64_t) uaddr & (HPGSIZE - 1));
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
@@ -240,13 +542,93 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 	ASSERT (is_user_vaddr (upage));
 	ASSERT (pml4 != base_pml4);
 
+	huge_split (pml4, (uint64_t) upage);
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		uint64_t old = *pte;
+
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		/* Remapping (e.g. making a page read-only for COW) must
+		 * not leave the old translation cached. */
+		if (old & PTE_P)
+			tlb_invalidate (pml4, (uint64_t) upage);
+	}
 	return pte != NULL;
 }
 
+/* Maps CNT consecutive user virtual pages starting at UPAGE to
+ * the frames KPAGES[0], KPAGES[1], ... in PML4, like CNT calls
+ * to pml4_set_page() but walking the upper levels only once for
+ * each page table, that is, once per 2 MB of address space.
+ * None of the pages may already be mapped.
+ * Returns the number of leading pages mapped, which is less than
+ * CNT only if a page table could not be allocated. */
+size_t
+pml4_set_pages (uint64_t *pml4, void *upage, void *const kpages[],
+		size_t cnt, bool rw) {
+	size_t i = 0;
+
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (cnt == 0 || is_user_vaddr (upage + (cnt - 1) * PGSIZE));
+	ASSERT (pml4 != base_pml4);
+
+	while (i < cnt) {
+		uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage + i * PGSIZE, 1);
+
+		if (pte == NULL)
+			break;
+		/* PTEs within one page table are contiguous. */
+		do {
+			ASSERT (pg_ofs (kpages[i]) == 0);
+			*pte++ = vtop (kpages[i]) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+			i++;
+		} while (i < cnt && PTX (upage + i * PGSIZE) != 0);
+	}
+	return i;
+}
+
+/* Maps the HPGSIZE bytes at user virtual address UPAGE to the
+ * physically contiguous frames at kernel virtual address KPAGE
+ * with a single large-page entry.  Both must be HPGSIZE-aligned
+ * and nothing in the range may be mapped.  The page table that
+ * covered the range is kept in reserve for when the large page
+ * is split.  Returns false if memory allocation failed or part
+ * of the range is mapped. */
+bool
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	uint64_t *pde, *pt;
+
+	ASSERT ((uint64_t) upage % HPGSIZE == 0);
+	ASSERT (vtop (kpage) % HPGSIZE == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	if (pml4e_walk (pml4, (uint64_t) upage, 1) == NULL)
+		return false;
+	pde = pde_lookup (pml4, (uint64_t) upage);
+	if (*pde & PTE_PS)
+		return false;
+	pt = ptov (PTE_ADDR (*pde));
+	for (unsigned i = 0; i < HPG_CNT; i++)
+		if (pt[i] & PTE_P)
+			return false;
+
+	pt_reserve_push (pt);
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	/* The CPU may have cached the PDE that pointed to PT, which
+	 * is now reused as the reserve's link. */
+	tlb_invalidate (pml4, (uint64_t) upage);
+	return true;
+}
+
+/* Returns true if UPAGE is mapped by a large page in PML4. */
+bool
+pml4_is_huge (uint64_t *pml4, const void *upage) {
+	return pde_is_huge (pde_lookup (pml4, (uint64_t) upage));
+}
+
 /* Marks user virtual page UPAGE "not present" in page
  * directory PD.  Later accesses to the page will fault.  Other
  * bits in the page table entry are preserved.
@@ -257,12 +639,14 @@ pml4_clear_page (uint64_t *pml4, void *upage) {
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (is_user_vaddr (upage));
 
+	huge_split (pml4, (uint64_t) upage);
 	pte = pml4e_walk (pml4, (uint64_t) upage, false);
 
 	if (pte != NULL && (*pte & PTE_P) != 0) {
-		*pte &= ~PTE_P;
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) upage);
+		/* Atomic: another CPU may be setting the accessed or dirty
+		 * bit in the same entry. */
+		__atomic_fetch_and (pte, ~(uint64_t) PTE_P, __ATOMIC_SEQ_CST);
+		tlb_invalidate (pml4, (uint64_t) upage);
 	}
 }
 
@@ -280,15 +664,15 @@ pml4_is_dirty (uint64_t *pml4, const void *vpage) {
  * in PML4. */
 void
 pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
+	huge_split (pml4, (uint64_t) vpage);
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
 		if (dirty)
-			*pte |= PTE_D;
+			__atomic_fetch_or (pte, PTE_D, __ATOMIC_SEQ_CST);
 		else
-			*pte &= ~(uint32_t) PTE_D;
+			__atomic_fetch_and (pte, ~(uint64_t) PTE_D, __ATOMIC_SEQ_CST);
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, (uint64_t) vpage);
 	}
 }
 
@@ -310,14 +694,14 @@ pml4_is_accessed (uint64_t *pml4, const void *vpage) {
 /* PD의 가상 페이지 VPAGE에 대해 PTE에서 액세스된 비트를 ACCESSED로 설정합니다. */
 void
 pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
+	huge_split (pml4, (uint64_t) vpage);
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) vpage, false);
 	if (pte) {
 		if (accessed)
-			*pte |= PTE_A;
+			__atomic_fetch_or (pte, PTE_A, __ATOMIC_SEQ_CST);
 		else
-			*pte &= ~(uint32_t) PTE_A;
+			__atomic_fetch_and (pte, ~(uint64_t) PTE_A, __ATOMIC_SEQ_CST);
 
-		if (rcr3 () == vtop (pml4))
-			invlpg ((uint64_t) vpage);
+		tlb_invalidate (pml4, (uint64_t) vpage);
 	}
 }
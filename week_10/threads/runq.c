@@ -0,0 +1,79 @@
+#include "threads/runq.h"
+#include <debug.h>
+
+/* Index of the highest set bit in MASK, which must be nonzero. */
+static inline int
+highest_bit (uint64_t mask) {
+	return 63 - __builtin_clzll (mask);
+}
+
+/* Initializes RQ as an empty run queue. */
+void
+runq_init (struct runq *rq) {
+	rq->ready_mask = 0;
+	rq->size = 0;
+	for (int p = PRI_MIN; p <= PRI_MAX; p++)
+		list_init (&rq->lists[p]);
+}
+
+/* Adds T behind the other threads of its priority in RQ. */
+void
+runq_push (struct runq *rq, struct thread *t) {
+	int p = t->priority;
+
+	ASSERT (PRI_MIN <= p && p <= PRI_MAX);
+	list_push_back (&rq->lists[p], &t->elem);
+	t->runq = rq;
+	rq->ready_mask |= 1ULL << p;
+	rq->size++;
+}
+
+/* Removes T, which must be in RQ, from RQ. */
+void
+runq_remove (struct runq *rq, struct thread *t) {
+	int p = t->priority;
+
+	ASSERT (t->runq == rq);
+	ASSERT (rq->ready_mask & (1ULL << p));
+	list_remove (&t->elem);
+	t->runq = NULL;
+	if (list_empty (&rq->lists[p]))
+		rq->ready_mask &= ~(1ULL << p);
+	rq->size--;
+}
+
+/* Removes and returns the thread that has waited longest among
+   the highest priority threads in RQ, or a null pointer if RQ is
+   empty. */
+struct thread *
+runq_pop (struct runq *rq) {
+	struct thread *t;
+	int p;
+
+	if (rq->ready_mask == 0)
+		return NULL;
+	p = highest_bit (rq->ready_mask);
+	t = list_entry (list_pop_front (&rq->lists[p]), struct thread, elem);
+	t->runq = NULL;
+	if (list_empty (&rq->lists[p]))
+		rq->ready_mask &= ~(1ULL << p);
+	rq->size--;
+	return t;
+}
+
+/* Returns the highest priority of a thread in RQ, or PRI_MIN - 1
+   if RQ is empty. */
+int
+runq_max_priority (const struct runq *rq) {
+	return rq->ready_mask != 0 ? highest_bit (rq->ready_mask) : PRI_MIN - 1;
+}
+
+bool
+runq_empty (const struct runq *rq) {
+	return rq->ready_mask == 0;
+}
+
+size_t
+runq_size (const struct runq *rq) {
+	return rq->size;
+}
@@ -0,0 +1,59 @@
+#include "threads/spinlock.h"
+#include <debug.h>
+#include <stddef.h>
+#include "threads/cpu.h"
+#include "threads/interrupt.h"
+
+/* Initializes LOCK as released. */
+void
+spinlock_init (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	lock->locked = 0;
+	lock->holder = NULL;
+}
+
+/* Spins until LOCK is free and takes it.  Interrupts must be
+   off, and LOCK must not already be held by this CPU. */
+void
+spinlock_acquire (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+	ASSERT (!spinlock_held_by_current_cpu (lock));
+
+	while (__atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+		while (lock->locked)
+			asm volatile ("pause");
+	lock->holder = cpu_current ();
+}
+
+/* Takes LOCK if it is free.  Returns true if it did.
+   Interrupts must be off. */
+bool
+spinlock_try_acquire (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	if (lock->locked || __atomic_exchange_n (&lock->locked, 1, __ATOMIC_ACQUIRE))
+		return false;
+	lock->holder = cpu_current ();
+	return true;
+}
+
+/* Releases LOCK, which this CPU must hold. */
+void
+spinlock_release (struct spinlock *lock) {
+	ASSERT (lock != NULL);
+	ASSERT (spinlock_held_by_current_cpu (lock));
+
+	lock->holder = NULL;
+	__atomic_store_n (&lock->locked, 0, __ATOMIC_RELEASE);
+}
+
+/* Returns true if this CPU holds LOCK. */
+bool
+spinlock_held_by_current_cpu (const struct spinlock *lock) {
+	ASSERT (lock != NULL);
+
+	return lock->locked && lock->holder == cpu_current ();
+}
@@ -203,9 +203,11 @@ lock_acquire (struct lock *lock) {
 	ASSERT (!lock_held_by_current_thread (lock));
 
 	struct thread *t = thread_current();
+	/* holder를 보고 기부하는 동안 다른 CPU가 lock을 놓거나 잡지 못하게 한다. */
+	enum intr_level old_level = intr_disable ();
 
 	/*done 시작*/
-	if (lock -> holder){				//lock의 holder가 있는 경우
+	if (!thread_mlfqs && lock -> holder){	//lock의 holder가 있는 경우 (MLFQS는 donation을 하지 않는다)
 		t -> wait_lock = lock;			//해당 lock을 스레드의 wait_lock으로 저장
 
 		//해당 lock을 갖고 있던 스래드의 도네이션 리스트에 t스레드를 넣는다. 
@@ -216,6 +218,7 @@ lock_acquire (struct lock *lock) {
 	sema_down (&lock->semaphore); 
 	t -> wait_lock = NULL;  
 	lock->holder = t; 
+	intr_set_level (old_level);
 }      
  
 /* LOCK 획득을 시도하고 성공하면 true를 반환하고 실패하면 false를 반환합니다.
@@ -244,12 +247,16 @@ lock_release (struct lock *lock) {
 	ASSERT (lock != NULL);
 	ASSERT (lock_held_by_current_thread (lock));
 
+	enum intr_level old_level = intr_disable ();
 	lock->holder = NULL;
 
-	remove_with_lock(lock);       //donaion 리스트에서 내 락을 원하는 스레드 삭제
-	refresh_priority();           //priority 되돌리기
+	if (!thread_mlfqs) {
+		remove_with_lock(lock);       //donaion 리스트에서 내 락을 원하는 스레드 삭제
+		refresh_priority();           //priority 되돌리기
+	}
 
 	sema_up (&lock->semaphore);
+	intr_set_level (old_level);
 }
 
 /* 현재 스레드가 LOCK을 유지하면 true를 반환하고 그렇지 않으면 false를 반환합니다. 
@@ -1,5 +1,9 @@
 threads_SRC  = threads/init.c		# Main program.
 threads_SRC += threads/thread.c		# Thread management core.
+threads_SRC += threads/runq.c		# Priority run queue.
+threads_SRC += threads/cpu.c		# Per-CPU data and SMP startup.
+threads_SRC += threads/ap-start.S	# Application processor startup code.
+threads_SRC += threads/spinlock.c	# Spinlocks.
 threads_SRC += threads/interrupt.c	# Interrupt core.
 threads_SRC += threads/intr-stubs.S	# Interrupt stubs.
 threads_SRC += threads/synch.c		# Synchronization.
@@ -4,12 +4,17 @@
 #include <random.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/cpu.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/runq.h"
+#include "threads/spinlock.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/lapic.h"
+#include "devices/timer.h"
 #include "intrinsic.h"
 #ifdef USERPROG
 #include "userprog/process.h"
@@ -32,27 +37,29 @@
 /* List of processes in THREAD_READY state, that is, processes
    that are ready to run but not actually running. */
 /* THREAD_READY 상태의 프로세스, 즉 프로세스 목록
-    실행할 준비가 되었지만 실제로 실행되지는 않습니다. */
-static struct list ready_list;
+    실행할 준비가 되었지만 실제로 실행되지는 않습니다.
+   우선순위마다 FIFO 리스트를 두고 비어 있지 않은 우선순위를 비트맵으로 기록해서
+   넣기, 빼기, 가장 높은 우선순위 찾기가 모두 상수 시간이다 (threads/runq.c).
+   CPU마다 하나씩 struct cpu의 runq에 있다 (threads/cpu.h). */
 
-/*잠자는 스레드 리스트*/
-static struct list sleep_list;
+/*잠자는 스레드들. wakeup_time이 가장 이른 스레드가 맨 위에 오는 힙*/
+static struct heap sleep_heap;
+static struct spinlock sleep_lock;		/* sleep_heap과 next_thread_to_awake를 보호 */
 
-/*sleep_list에서 대기중인 스레드들의 wakeup_tick값 중 최소값을 저장*/
-int64_t next_thread_to_awake;
+/* 살아 있는 모든 스레드 (MLFQS가 1초마다 recent_cpu를 감쇠시킬 때 훑는다). */
+static struct list all_list;
+static struct spinlock all_lock;		/* all_list를 보호 */
 
-/* Idle thread. */
-/* 사용 가능한 thread */
-static struct thread *idle_thread;
+/*sleep_heap에서 대기중인 스레드들의 wakeup_tick값 중 최소값을 저장 (없으면 INT64_MAX)*/
+int64_t next_thread_to_awake = INT64_MAX;
+static bool wakeup_less (const struct heap_elem *a, const struct heap_elem *b, void *aux);
+
+/* Idle thread: CPU마다 하나씩 struct cpu의 idle_thread에 있다. */
 
 /* Initial thread, the thread running init.c:main(). */
 /* 초기 스레드, init.c:main()을 실행하는 스레드. */
 static struct thread *initial_thread;
 
-/* Lock used by allocate_tid(). */
-/* allocate_tid()에 의해 사용되는 lock. */
-static struct lock tid_lock;
-
 /* Thread destruction requests */
 /* Thread 파괴 요청 */
 static struct list destruction_req;
@@ -67,7 +74,7 @@ static long long user_ticks;    /* # of timer ticks in user programs. 사용자
 
 /* Scheduling. */
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. 각 스레드에 제공하는 타이머 틱 수.*/
-static unsigned thread_ticks;   /* # of timer ticks since last yield. 마지막 yield 이후 타이머 틱 수.*/
+/* 마지막 yield 이후 타이머 틱 수는 CPU마다 struct cpu의 slice_ticks에 있다. */
 
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
@@ -77,9 +84,25 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. 마지막
     커널 명령줄 옵션 "-o mlfqs"에 의해 제어됩니다. */
 bool thread_mlfqs;
 
+/* 4.4BSD 스케줄러 (-mlfqs).
+   우선순위 = PRI_MAX - recent_cpu / 4 - nice * 2 이고 4 tick마다 다시 계산한다.
+   recent_cpu는 실행 중인 스레드만 tick마다 1씩 늘고, 1초에 한 번 모든 스레드가
+   (2 * load_avg) / (2 * load_avg + 1)배로 줄어든 뒤 nice가 더해진다.
+   그래서 4 tick마다 우선순위가 바뀔 수 있는 것은 실행 중인 스레드뿐이고,
+   모든 스레드를 훑는 것은 1초에 한 번이다.
+   load_avg는 1초마다 실행 가능한 스레드 수의 지수 평균이다.
+   값은 17.14 고정소수점(threads/fixed-point.h)이다. */
+#define MLFQS_PRI_TICKS 4
+static fixed_t load_avg;
+static void mlfqs_tick (struct thread *t);
+static void mlfqs_update_priority (struct thread *t);
+
 static void kernel_thread (thread_func *, void *aux);
 
-static void idle (void *aux UNUSED);
+static void idle (void *aux);
+static bool is_idle_thread (const struct thread *t);
+static void thread_kick (struct thread *t);
+static int ready_max_priority (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static void do_schedule(int status);
@@ -119,7 +142,7 @@ static uint64_t gdt[3] = { 0, 0x00af9a000000ffff, 0x00cf92000000ffff };
    general and it is possible in this case only because loader.S
    was careful to put the bottom of the stack at a page boundary.
 
-   Also initializes the run queue and the tid lock.
+   Also initializes the run queue.
 
    After calling this function, be sure to initialize the page
    allocator before trying to create any threads with
@@ -129,7 +152,7 @@ static uint64_t gdt[3] = { 0, 0x00af9a000000ffff, 0x00cf92000000ffff };
    finishes. */
 /* 현재 실행 중인 코드를 스레드로 변환하여 스레드 시스템을 초기화합니다. 이것은 일반적으로 작동하지 않으며 이 경우에만 가능합니다. 
 loader.S가 스택의 맨 아래를 페이지 경계에 두도록 주의했기 때문입니다.
-또한 실행 대기열과 tid 잠금을 초기화합니다.
+또한 실행 대기열을 초기화합니다.
 이 함수를 호출한 후 thread_create()로 스레드를 생성하기 전에 페이지 할당자를 초기화해야 합니다.
 이 함수가 완료될 때까지 thread_current()를 호출하는 것은 안전하지 않습니다. */
 void
@@ -150,11 +173,13 @@ thread_init (void) {
 
 	/* Init the globla thread context */
 	/* 전역 스레드 컨텍스트 초기화 */
-	lock_init (&tid_lock);
-	list_init (&ready_list);
+	runq_init (&cpu_current ()->runq);
+	list_init (&all_list);
+	spinlock_init (&all_lock);
+	spinlock_init (&sleep_lock);
 	list_init (&destruction_req);
 
-	list_init (&sleep_list);
+	heap_init (&sleep_heap, wakeup_less, NULL);
 
 	/* Set up a thread structure for the running thread. */
 	/* 실행 중인 스레드에 대한 스레드 구조를 설정합니다. */
@@ -162,6 +187,35 @@ thread_init (void) {
 	init_thread (initial_thread, "main", PRI_DEFAULT);
 	initial_thread->status = THREAD_RUNNING;
 	initial_thread->tid = allocate_tid ();
+	cpu_current ()->curr = initial_thread;
+}
+
+/* 응용 프로세서가 ap_main()에서 인터럽트를 끈 채로 부른다.
+   smp_init()이 준 부팅 스택 페이지에서 돌고 있는 지금 코드를 이 CPU의 idle 스레드로 만든다.
+   thread_init()이 BSP의 부팅 스택을 main 스레드로 만드는 것과 같다. */
+void
+thread_init_ap (void) {
+	struct cpu *c = cpu_current ();
+	struct thread *t = running_thread ();
+	char name[16];
+
+	ASSERT (intr_get_level () == INTR_OFF);
+
+	snprintf (name, sizeof name, "idle%d", c->id);
+	init_thread (t, name, PRI_MIN);
+	t->status = THREAD_RUNNING;
+	t->tid = allocate_tid ();
+	c->idle_thread = t;
+	c->curr = t;
+}
+
+/* 응용 프로세서가 준비를 마치고 부른다. 인터럽트를 켜고 idle 스레드로서
+   다른 CPU들과 함께 실행 대기열의 스레드를 돌리기 시작한다. */
+void
+thread_start_ap (void) {
+	intr_enable ();
+	idle (NULL);
+	NOT_REACHED ();
 }
 
 void
@@ -172,8 +226,11 @@ thread_sleep(int64_t ticks){
 	old_level = intr_disable (); 		//interrupt off
 
 	cur -> wakeup_time = ticks;		//깨어나야 할 ticks 저장
-	// list_push_back (&sleep_list, &cur->elem);	//슬립 큐 삽입/
-	list_insert_ordered (&sleep_list, &cur->elem, more, 0);
+	spinlock_acquire (&sleep_lock);
+	heap_push (&sleep_heap, &cur->sleep_elem);	//슬립 힙 삽입, O(1)
+	if (ticks < next_thread_to_awake)
+		next_thread_to_awake = ticks;
+	spinlock_release (&sleep_lock);
 
 	thread_block();					//block하고
 	intr_set_level (old_level);			//interrupt on
@@ -181,19 +238,33 @@ thread_sleep(int64_t ticks){
 
 void
 thread_awake (int64_t ticks){		// 현재 시간
-	/*sleep_list의 모든 entry순회*/
-  struct list_elem *e = list_begin (&sleep_list); 	//sleep_list의 시작 스레드 포인터를 리스트요소로 할당
+	/*깨울 시간이 된 스레드만 힙의 맨 위에서 꺼낸다. 하나당 O(log n)*/
+	spinlock_acquire (&sleep_lock);
+	while (!heap_empty (&sleep_heap)) {
+		struct thread *t = heap_entry (heap_min (&sleep_heap), struct thread, sleep_elem);
+
+		if (t->wakeup_time > ticks)
+			break;
+		heap_pop (&sleep_heap);
+		thread_unblock (t);	// 스레드 unblock
+	}
+	next_thread_to_awake = heap_empty (&sleep_heap) ? INT64_MAX
+		: heap_entry (heap_min (&sleep_heap), struct thread, sleep_elem)->wakeup_time;
+	spinlock_release (&sleep_lock);
+
+	/*깨운 스레드 중 가장 높은 우선순위와 한 번만 비교*/
+	thread_comp_ready();
+}
 
-  while (e != list_end (&sleep_list)){				//sleep_list의 시작과 끝이 같지 않다면 반복문 시작(같을때까지)
-    struct thread *t = list_entry (e, struct thread, elem); 	//e(sleep_list 시작)의 포인터를 thread t 구조체 포인터로 할당 
-    if (t->wakeup_time <= ticks){	// 스레드의 일어난 시간이 지금 시간보다 작거나 같으면
-      e = list_remove (e);	// sleep list 에서 제거 
-      thread_unblock (t);	// 스레드 unblock
-	  thread_comp_ready();
-    }
-    else 
-      e = list_next (e);
-  }
+/*wakeup_time이 이른 스레드가 먼저. 같으면 우선순위가 높은 스레드가 먼저*/
+static bool
+wakeup_less (const struct heap_elem *a_, const struct heap_elem *b_, void *aux UNUSED) {
+	const struct thread *a = heap_entry (a_, struct thread, sleep_elem);
+	const struct thread *b = heap_entry (b_, struct thread, sleep_elem);
+
+	if (a->wakeup_time != b->wakeup_time)
+		return a->wakeup_time < b->wakeup_time;
+	return a->priority > b->priority;
 }
 
 /*
@@ -242,8 +313,10 @@ void
 thread_tick (void) {
 	struct thread *t = thread_current ();
 
+	struct cpu *c = cpu_current ();
+
 	/* Update statistics. */
-	if (t == idle_thread)
+	if (t == c->idle_thread)
 		idle_ticks++;
 #ifdef USERPROG
 	else if (t->pml4 != NULL)
@@ -252,13 +325,22 @@ thread_tick (void) {
 	else
 		kernel_ticks++;
 
+	if (thread_mlfqs)
+		mlfqs_tick (t);
+
 	/* Enforce preemption. */
 	/* ticks가 TIMAE_SLICE 보다 커지는 순간  intr_yield_on_return ()실행
 	이 인터럽트는 결과적으로 thread_yield()를 실행 시킨다.*/
-	if (++thread_ticks >= TIME_SLICE)
+	if (++c->slice_ticks >= TIME_SLICE)
 		intr_yield_on_return ();
 }
 
+/* tick이 멈춘 idle 동안 지나간 N tick을 idle 시간으로 센다. */
+void
+thread_idle_ticks (int64_t n) {
+	idle_ticks += n;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) {
@@ -309,6 +391,13 @@ thread_create (const char *name, int priority,
 	init_thread (t, name, priority);
 	tid = t->tid = allocate_tid ();
 
+	/* MLFQS에서는 만든 스레드의 nice와 recent_cpu를 물려받고 우선순위는 계산한다. */
+	if (thread_mlfqs) {
+		t->nice = thread_current ()->nice;
+		t->recent_cpu = thread_current ()->recent_cpu;
+		mlfqs_update_priority (t);
+	}
+
 	/*project 2_ system call*/
 	t -> file_descriptor_table = palloc_get_multiple(PAL_ZERO, FDT_PAGES);
 	if (t->file_descriptor_table == NULL){
@@ -333,7 +422,9 @@ thread_create (const char *name, int priority,
 	t->tf.es = SEL_KDSEG;
 	t->tf.ss = SEL_KDSEG;
 	t->tf.cs = SEL_KCSEG;
-	t->tf.eflags = FLAG_IF;
+	/* 인터럽트를 끈 채로 시작해서 인터럽트 락을 넘겨받고,
+	   kernel_thread()의 intr_enable()에서 놓는다. */
+	t->tf.eflags = 0;
 
 	/* Add to run queue. */
 	thread_unblock (t);
@@ -380,8 +471,9 @@ thread_unblock (struct thread *t) {
 
 	old_level = intr_disable ();
 	ASSERT (t->status == THREAD_BLOCKED);
-	list_insert_ordered (&ready_list, &t->elem, more, 0);
+	runq_push (&cpu_current ()->runq, t);
 	t->status = THREAD_READY;
+	thread_kick (t);
 	
 	intr_set_level (old_level);
 	
@@ -433,6 +525,9 @@ thread_exit (void) {
 	/* Just set our status to dying and schedule another process.
 	   We will be destroyed during the call to schedule_tail(). */
 	intr_disable ();
+	spinlock_acquire (&all_lock);
+	list_remove (&thread_current ()->all_elem);
+	spinlock_release (&all_lock);
 	do_schedule (THREAD_DYING);
 	NOT_REACHED ();
 }
@@ -442,26 +537,27 @@ thread_exit (void) {
 /* CPU를 양보합니다. 현재 스레드는 휴면 상태가 아니며 스케줄러의 변덕에 따라 즉시 다시 예약될 수 있습니다. */
 void
 thread_yield (void) {
-	struct thread *curr = thread_current ();
 	enum intr_level old_level;
 
 	ASSERT (!intr_context ());
 
 	old_level = intr_disable ();					//intr off
-	if (curr != idle_thread)						//놀고 있면 
-		list_insert_ordered (&ready_list, &curr->elem, more, 0);
-	do_schedule (THREAD_READY);
+	do_schedule (THREAD_READY);					//실행 대기열에는 do_schedule()이 넣는다
 	intr_set_level (old_level);						//intr on
 }
 
-/*지금 실행중인 스레드의 우선순위와 ready_list 맨 앞에 스레드우선순위를 비교하여 y*/
+/*지금 실행중인 스레드의 우선순위와 ready_queue에서 가장 높은 우선순위를 비교하여 y*/
 void
 thread_comp_ready() {
 	struct thread *curr = thread_current();
-	int e = (list_entry(list_begin (&ready_list), struct thread , elem) -> priority);
-
-	if (curr -> priority < e && thread_current() != idle_thread){ 
-		thread_yield();
+	int e = ready_max_priority ();
+
+	if (curr -> priority < e && thread_current() != cpu_current ()->idle_thread){ 
+		/* 인터럽트 핸들러(타이머, 디스크의 sema_up)에서는 돌아갈 때 양보한다. */
+		if (intr_context ())
+			intr_yield_on_return ();
+		else
+			thread_yield();
 	}
 
 }
@@ -470,9 +566,15 @@ thread_comp_ready() {
 void
 thread_set_priority (int new_priority) {
 	struct thread *curr = thread_current();
+
+	/* MLFQS에서는 스케줄러가 우선순위를 정한다. */
+	if (thread_mlfqs)
+		return;
 	curr->init_priority = new_priority;
 
+	enum intr_level old_level = intr_disable ();
 	refresh_priority();
+	intr_set_level (old_level);
 
 	thread_comp_ready();
 	
@@ -485,30 +587,117 @@ thread_get_priority (void) {
 }
 
 /* Sets the current thread's nice value to NICE. */
+/* 우선순위를 다시 계산하고, 더 높은 스레드가 있으면 양보한다. */
 void
-thread_set_nice (int nice UNUSED) {
-	/* TODO: Your implementation goes here */
+thread_set_nice (int nice) {
+	enum intr_level old_level;
+
+	if (nice < NICE_MIN)
+		nice = NICE_MIN;
+	if (nice > NICE_MAX)
+		nice = NICE_MAX;
+
+	old_level = intr_disable ();
+	thread_current ()->nice = nice;
+	mlfqs_update_priority (thread_current ());
+	intr_set_level (old_level);
+	thread_comp_ready ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int load = fp_round (fp_mul_int (load_avg, 100));
+
+	intr_set_level (old_level);
+	return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) {
-	/* TODO: Your implementation goes here */
-	return 0;
+	enum intr_level old_level = intr_disable ();
+	int recent = fp_round (fp_mul_int (thread_current ()->recent_cpu, 100));
+
+	intr_set_level (old_level);
+	return recent;
+}
+
+/* T의 우선순위를 recent_cpu와 nice로 다시 계산한다.
+   ready_queue 안에 있으면 새 우선순위의 자리로 옮긴다. 인터럽트를 끄고 불러야 한다. */
+static void
+mlfqs_update_priority (struct thread *t) {
+	int priority = PRI_MAX - fp_trunc (fp_div_int (t->recent_cpu, 4)) - t->nice * 2;
+
+	if (priority < PRI_MIN)
+		priority = PRI_MIN;
+	if (priority > PRI_MAX)
+		priority = PRI_MAX;
+	if (priority == t->priority)
+		return;
+	if (t->status == THREAD_READY) {
+		struct runq *rq = t->runq;
+
+		runq_remove (rq, t);
+		t->priority = priority;
+		runq_push (rq, t);
+	}
+	else
+		t->priority = priority;
+}
+
+/* 1초마다: load_avg를 갱신하고 모든 스레드의 recent_cpu를 감쇠시킨 뒤 우선순위를 다시 계산한다. */
+static void
+mlfqs_second (void) {
+	int ready = 0;
+	fixed_t coef;
+	struct list_elem *e;
+
+	/* 모든 CPU의 실행 대기열과 실행 중인 스레드를 센다. */
+	for (int i = 0; i < cpu_cnt; i++)
+		ready += runq_size (&cpus[i].runq) + (cpus[i].curr != cpus[i].idle_thread);
+
+	load_avg = fp_add (fp_mul (fp_div_int (fp_from_int (59), 60), load_avg),
+			fp_div_int (fp_from_int (ready), 60));
+	coef = fp_div (fp_mul_int (load_avg, 2), fp_add_int (fp_mul_int (load_avg, 2), 1));
+
+	spinlock_acquire (&all_lock);
+	for (e = list_begin (&all_list); e != list_end (&all_list); e = list_next (e)) {
+		struct thread *t = list_entry (e, struct thread, all_elem);
+
+		if (is_idle_thread (t))
+			continue;
+		t->recent_cpu = fp_add_int (fp_mul (coef, t->recent_cpu), t->nice);
+		mlfqs_update_priority (t);
+	}
+	spinlock_release (&all_lock);
+}
+
+/* 타이머 인터럽트마다 불린다. T는 실행 중인 스레드. */
+static void
+mlfqs_tick (struct thread *t) {
+	struct cpu *c = cpu_current ();
+	int64_t now = timer_ticks ();
+
+	if (t != c->idle_thread)
+		t->recent_cpu = fp_add_int (t->recent_cpu, 1);
+
+	/* ticks는 BSP만 세므로 1초마다 하는 일도 BSP만 한다. */
+	if (now % TIMER_FREQ == 0 && c->id == 0)
+		mlfqs_second ();
+	else if (now % MLFQS_PRI_TICKS == 0 && t != c->idle_thread)
+		mlfqs_update_priority (t);
+
+	/* 실행 중인 스레드보다 우선순위가 높은 스레드가 생겼으면 양보한다. */
+	if (t != c->idle_thread && ready_max_priority () > t->priority)
+		intr_yield_on_return ();
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -520,16 +709,19 @@ thread_get_recent_cpu (void) {
    blocks.  After that, the idle thread never appears in the
    ready list.  It is returned by next_thread_to_run() as a
    special case when the ready list is empty. */
+/* 응용 프로세서에서는 thread_start_ap()가 IDLE_STARTED 없이 부른다. */
 static void
-idle (void *idle_started_ UNUSED) {
+idle (void *idle_started_) {
 	struct semaphore *idle_started = idle_started_;
 
-	idle_thread = thread_current ();
-	sema_up (idle_started);
+	cpu_current ()->idle_thread = thread_current ();
+	if (idle_started != NULL)
+		sema_up (idle_started);
 
 	for (;;) {
 		/* Let someone else run. */
 		intr_disable ();
+		timer_idle_exit ();		// tick이 멈춰 있었다면 다시 켠다
 		thread_block ();
 
 		/* Re-enable interrupts and wait for the next one.
@@ -544,6 +736,8 @@ idle (void *idle_started_ UNUSED) {
 
 		   See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
 		   7.11.1 "HLT Instruction". */
+		timer_idle_enter ();	// 깨울 스레드가 없는 동안 tick을 멈춘다
+		intr_disable_unlocked ();	// 멈춰 있는 동안 다른 CPU가 인터럽트 락을 쓸 수 있게 한다
 		asm volatile ("sti; hlt" : : : "memory");
 	}
 }
@@ -581,6 +775,8 @@ kernel_thread (thread_func *function, void *aux) {
 /* NAME이라는 이름의 block된 스레드로 T의 기본 초기화를 수행합니다. */
 static void
 init_thread (struct thread *t, const char *name, int priority) {
+	enum intr_level old_level;
+
 	ASSERT (t != NULL);
 	ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);	
 	ASSERT (name != NULL);
@@ -591,6 +787,14 @@ init_thread (struct thread *t, const char *name, int priority) {
 	t->tf.rsp = (uint64_t) t + PGSIZE - sizeof (void *);
 	t->priority = priority;
 	t->magic = THREAD_MAGIC;
+	t->nice = NICE_DEFAULT;
+	t->recent_cpu = 0;
+
+	old_level = intr_disable ();
+	spinlock_acquire (&all_lock);
+	list_push_back (&all_list, &t->all_elem);
+	spinlock_release (&all_lock);
+	intr_set_level (old_level);
 	
 	/*priority donation 관련 자료구조 초기화*/
 	t->init_priority = priority;
@@ -607,6 +811,11 @@ init_thread (struct thread *t, const char *name, int priority) {
 	sema_init(&t->sema_wait, 0);
 	sema_init(&t->sema_free, 0);
 
+#ifdef VM
+	/* 빈 spt로 시작해야 process_cleanup()이 언제든 정리할 수 있다. */
+	supplemental_page_table_init (&t->spt);
+#endif
+
 
 
 }
@@ -621,7 +830,18 @@ dona_priority(void){
 			break;
 		}
 		struct thread *t = cur_t -> wait_lock->holder;
-		t -> priority = cur_t -> priority;
+		/* ready_queue 안의 스레드는 우선순위를 바꾸기 전에 빼서 새 자리에 넣는다. */
+		enum intr_level old_level = intr_disable ();
+		if (t->status == THREAD_READY) {
+			struct runq *rq = t->runq;
+
+			runq_remove (rq, t);
+			t -> priority = cur_t -> priority;
+			runq_push (rq, t);
+		}
+		else
+			t -> priority = cur_t -> priority;
+		intr_set_level (old_level);
 		cur_t = t;  
 	}
 }
@@ -666,18 +886,85 @@ refresh_priority(void){
    will be in the run queue.)  If the run queue is empty, return
    idle_thread. */
 /*ready queue에서 다음에 실행될 스레드를 골라 return*/
+/* 모든 CPU의 실행 대기열 중 가장 높은 우선순위의 스레드를 가진 대기열에서 꺼낸다.
+   같으면 이 CPU의 대기열을 먼저 쓴다 (캐시가 아직 따뜻하다). 인터럽트 락이 보호한다. */
 static struct thread *
 next_thread_to_run (void) {
-	if (list_empty (&ready_list))
-		return idle_thread;
+	struct cpu *c = cpu_current ();
+	struct runq *best = &c->runq;
+
+	for (int i = 0; i < cpu_cnt; i++)
+		if (runq_max_priority (&cpus[i].runq) > runq_max_priority (best))
+			best = &cpus[i].runq;
+
+	if (runq_empty (best))
+		return c->idle_thread;
 	else
-		return list_entry (list_pop_front (&ready_list), struct thread, elem);
+		return runq_pop (best);
+}
+
+/* 모든 CPU의 실행 대기열에서 가장 높은 우선순위를 돌려준다 (비었으면 PRI_MIN - 1). */
+static int
+ready_max_priority (void) {
+	int max = PRI_MIN - 1;
+
+	for (int i = 0; i < cpu_cnt; i++) {
+		int p = runq_max_priority (&cpus[i].runq);
+		if (p > max)
+			max = p;
+	}
+	return max;
+}
+
+/* T가 어느 CPU의 idle 스레드이면 true. */
+static bool
+is_idle_thread (const struct thread *t) {
+	for (int i = 0; i < cpu_cnt; i++)
+		if (cpus[i].idle_thread == t)
+			return true;
+	return false;
+}
+
+/* 방금 실행 대기열에 들어간 T를 돌릴 다른 CPU를 깨운다.
+   놀고 있는 CPU가 있으면 그 CPU를, 없으면 T보다 낮은 우선순위의 스레드를 돌리는 CPU 중
+   가장 낮은 것을 (이 CPU보다 낮을 때만) 고르고 IPI를 보내 스케줄러를 돌리게 한다.
+   이 CPU에서 양보할지는 thread_comp_ready()가 정한다. */
+static void
+thread_kick (struct thread *t) {
+	struct cpu *self = cpu_current ();
+	struct cpu *target = NULL;
+	int lowest;
+
+	if (cpu_cnt == 1)
+		return;
+	lowest = self->curr == self->idle_thread ? PRI_MIN - 1 : self->curr->priority;
+	if (lowest > t->priority)
+		lowest = t->priority;
+	for (int i = 0; i < cpu_cnt; i++) {
+		struct cpu *c = &cpus[i];
+
+		if (c == self)
+			continue;
+		if (c->curr == c->idle_thread) {
+			target = c;
+			break;
+		}
+		if (c->curr->priority < lowest) {
+			target = c;
+			lowest = c->curr->priority;
+		}
+	}
+	if (target != NULL)
+		lapic_send_ipi (target->apic_id, LAPIC_RESCHED_VEC);
 }
 
 /* Use iretq to launch the thread */
 /* Use iretq를 사용하여 스레드를 시작합니다. */
 void
 do_iret (struct intr_frame *tf) {
+	/* iretq가 인터럽트를 켜는 경우라면 인터럽트 락을 미리 놓는다. */
+	if (tf->eflags & FLAG_IF)
+		intr_disable_unlocked ();
 	__asm __volatile(
 			"movq %0, %%rsp\n"
 			"movq 0(%%rsp),%%r15\n"
@@ -699,7 +986,10 @@ do_iret (struct intr_frame *tf) {
 			"movw 8(%%rsp),%%ds\n"
 			"movw (%%rsp),%%es\n"
 			"addq $32, %%rsp\n"
-			"iretq"
+			"testb $3, 8(%%rsp)\n"   // 유저 모드로 돌아가면 GS 베이스를 돌려 준다
+			"jz 1f\n"
+			"swapgs\n"
+			"1: iretq"
 			: : "g" ((uint64_t) tf) : "memory");
 }
 
@@ -784,12 +1074,17 @@ do_schedule(int status) {									//intr off 상태에서 들어와 status(4가
 			list_entry (list_pop_front (&destruction_req), struct thread, elem); //dying리스트의 맨 앞을 꺼내오고
 		palloc_free_page(victim);							//꺼내온 thread를 삭제
 	}
+	/* 양보하는 스레드는 해제가 끝난 뒤에 실행 대기열에 넣는다.
+	   palloc_free_page()가 잠들었다 깨어나는 동안 다른 CPU가 이 스레드를 가져가면 안 된다. */
+	if (status == THREAD_READY && thread_current () != cpu_current ()->idle_thread)
+		runq_push (&cpu_current ()->runq, thread_current ());
 	thread_current ()->status = status;						//받아온 상태값으로 thread 생성
 	schedule ();											//새로 스캐즇
 }
 
 static void
 schedule (void) {
+	struct cpu *c = cpu_current ();
 	struct thread *curr = running_thread (); 		// 실행 중 스래드 curr
 	struct thread *next = next_thread_to_run ();	// 다음 실행될 스래드 next
 
@@ -799,9 +1094,10 @@ schedule (void) {
 	/* Mark us as running. */
 	
 	next->status = THREAD_RUNNING;					//다음 스래드의 status를 running 상태로
+	c->curr = next;
 
 	/* Start new time slice. */
-	thread_ticks = 0;								//ticks 초기화
+	c->slice_ticks = 0;								//ticks 초기화
 
 #ifdef USERPROG
 	/* Activate the new address space. */
@@ -827,11 +1123,7 @@ schedule (void) {
 static tid_t
 allocate_tid (void) {
 	static tid_t next_tid = 1;
-	tid_t tid;
 
-	lock_acquire (&tid_lock);
-	tid = next_tid++;
-	lock_release (&tid_lock);
-
-	return tid;
+	/* 응용 프로세서는 잠들 수 없는 idle 스레드에서 부르므로 lock 대신 원자적으로 늘린다. */
+	return __atomic_fetch_add (&next_tid, 1, __ATOMIC_RELAXED);
 }
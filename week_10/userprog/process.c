@@ -228,6 +228,9 @@ __do_fork (void *aux) {
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
+	current->stack_bottom = parent->stack_bottom;
+	current->heap_start = parent->heap_start;
+	current->brk = parent->brk;
 #else
 	if (!pml4_for_each (parent->pml4, duplicate_pte, parent))
 		goto error;
@@ -295,6 +298,7 @@ process_exec (void *f_name) { 				//실행함수
 	
 	#ifdef VM
 	supplemental_page_table_init(&thread_current()->spt);  // 추가!!
+	thread_current()->in_syscall = true;  // 인자를 새 스택에 쓰는 동안 ksmd가 건드리지 않게
 	#endif
 	
 	/* And then load the binary */
@@ -310,6 +314,9 @@ process_exec (void *f_name) { 				//실행함수
 	/* If load failed, quit. */
 	palloc_free_page (file_name);
 	/* Start switched process. */
+	#ifdef VM
+	thread_current()->in_syscall = false;
+	#endif
 	
 	do_iret (&_if);
 	NOT_REACHED ();
@@ -393,8 +400,7 @@ process_cleanup (void) {
 	struct thread *curr = thread_current ();
 	
 #ifdef VM
-	if(!hash_empty(&curr->spt.hashs))
-		supplemental_page_table_kill (&curr->spt);
+	supplemental_page_table_kill (&curr->spt);
 #endif
 
 	uint64_t *pml4;
@@ -551,6 +557,9 @@ load (const char *file_name, struct intr_frame *if_) {
 	}
 	
 	/* Read program headers. */
+#ifdef VM
+	t->heap_start = NULL;
+#endif
 	file_ofs = ehdr.e_phoff;
 	for (i = 0; i < ehdr.e_phnum; i++) {
 		struct Phdr phdr;
@@ -596,6 +605,11 @@ load (const char *file_name, struct intr_frame *if_) {
 					if (!load_segment (file, file_page, (void *) mem_page,
 								read_bytes, zero_bytes, writable))
 						goto done;
+#ifdef VM
+					/* 힙은 가장 높은 세그먼트 바로 뒤 페이지에서 시작한다. */
+					if ((void *) (mem_page + read_bytes + zero_bytes) > t->heap_start)
+						t->heap_start = (void *) (mem_page + read_bytes + zero_bytes);
+#endif
 				}
 				else
 					goto done;
@@ -604,6 +618,10 @@ load (const char *file_name, struct intr_frame *if_) {
 	}
 	
 	
+#ifdef VM
+	t->brk = t->heap_start;
+#endif
+
 	/* Set up stack. */
 	if (!setup_stack (if_)){
 		
@@ -836,23 +854,9 @@ lazy_load_segment (struct page *page, void *aux) {
 	/* TODO: This called when the first page fault occurs on address VA. */
 	/* TODO: VA is available when calling this function. */
 	
-	struct file *file = ((struct container*)aux)->file;
-	off_t offset = ((struct container*)aux)->offset;
-	size_t page_read_bytes = ((struct container*)aux)->page_read_bytes;
-	size_t page_zero_bytes = PGSIZE - page_read_bytes;
-	
-	file_seek(file, offset);  // file의 오프셋을 offset으로 바꾼다. 이제 offset부터 읽기 시작한다.
-
-	/* 페이지에 매핑된 물리 메모리(frame, 커널 가상 주소)에 파일의 데이터를 읽어온다. */
-	/* 제대로 못 읽어오면 페이지를 FREE시키고 FALSE 리턴 */
-	if (file_read(file, page->frame->kva, page_read_bytes) != (int)page_read_bytes){
-		palloc_free_page(page->frame->kva);
-		return false;
-	}
-	/* 만약 1페이지 못 되게 받아왔다면 남는 데이터를 0으로 초기화한다. */
-	memset(page->frame->kva + page_read_bytes, 0, page_zero_bytes); 
-	
-	return true;
+	/* 파일에서 이어지는 뒤쪽 페이지도 아직 안 읽었으면 한 번에 같이 읽어 매핑한다.
+	   (fault-around, vm/file.c) */
+	return file_read_around (page, page->frame->kva, aux);
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -884,6 +888,7 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
+	uint8_t *start = upage;
 	// file_seek(file,ofs);
 	while (read_bytes > 0 || zero_bytes > 0) {
 		/* 1 Page보다 같거나 작은 메모리를 한 단위로 해서 읽어 온다.
@@ -899,8 +904,15 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		container->page_read_bytes = page_read_bytes;
 		container->page_zero_bytes = page_zero_bytes;
 		container->offset = ofs;
+		container->window = file_fault_around;
+		container->around = file_fault_around;
+		container->shared = !writable;
+		container->drop_behind = false;
 		
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage, 
+		/* 읽기 전용 세그먼트(text)는 파일 페이지로 만든다. 더럽혀지지 않으므로
+		   쫓겨날 때 스왑에 쓰지 않고 버리며, 같은 실행 파일을 실행한 프로세스끼리
+		   프레임을 공유한다. 쓰기 가능한 세그먼트는 익명 페이지다. */
+		if (!vm_alloc_page_with_initializer (writable ? VM_ANON : VM_FILE, upage, 
 				writable, lazy_load_segment, container))
 		{
 			return false;
@@ -913,7 +925,10 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 		upage += PGSIZE;
 		ofs += page_read_bytes;
 	}
-	
+
+	/* -populate이면 폴트를 기다리지 않고 세그먼트를 지금 큰 단위로 읽어 매핑한다. */
+	if (vm_populate_exec)
+		vm_populate (&thread_current ()->spt, start, upage);
 	return true;
 }
 
@@ -39,6 +39,9 @@ int wait_syscall (pid_t pid);
 void check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write);
 void *mmap_syscall (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap_syscall(void *addr);
+int madvise_syscall (void *addr, size_t length, int advice);
+int msync_syscall (void *addr, size_t length);
+void *brk_syscall (void *addr);
  
 /* System call.
  *
@@ -71,7 +74,8 @@ check_address (const uint64_t *addr)
 	}
 
 	//유저 주소라면 stp에서 페이지를 찾는다. 
-	return spt_find_page(&cur->spt, addr);
+	//아직 페이지가 없는 mmap 영역이면 이때 만든다.
+	return spt_lookup_page(&cur->spt, addr);
 }
 
 int 
@@ -112,11 +116,13 @@ remove_file_from_fd_table(int fd){
 //project3
 void 
 check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write){
-	/* 버퍼 내의 시작부터 끝까지의 각 주소를 모두 check_address*/
-	
-	for (int i = 0; i < size; i++){
+	/* 버퍼가 걸쳐 있는 페이지마다 한 번씩 check_address
+	   (같은 페이지 안의 주소는 결과가 같으므로 바이트마다 볼 필요가 없다) */
+	if (size == 0)
+		return;
+	for (void *upage = pg_round_down(buffer); upage <= buffer + size - 1; upage += PGSIZE){
 
-		struct page* page = check_address(buffer + i); 
+		struct page* page = check_address(upage); 
 		/* 해당 주소가 포함된 페이지가 spt에 없다면 */
 		if(page == NULL)
 			exit_syscall(-1);
@@ -125,6 +131,10 @@ check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write){
 		if(to_write == true && page->writable == false)
 			exit_syscall(-1);
 
+		/* 커널이 쓸 페이지가 fork 후 공유(COW) 중이면 미리 복사해 둔다. */
+		if(to_write == true && !vm_prepare_write(page))
+			exit_syscall(-1);
+
 	}
 
 }
@@ -134,6 +144,13 @@ check_valid_buffer(void* buffer, unsigned size, void* rsp, bool to_write){
 
 void
 syscall_init (void) {
+	syscall_init_cpu ();
+	lock_init(&filesys_lock);
+}
+
+/* 실행 중인 CPU의 syscall MSR을 설정한다. AP는 ap_main()에서 따로 부른다. */
+void
+syscall_init_cpu (void) {
 	write_msr(MSR_STAR, ((uint64_t)SEL_UCSEG - 0x10) << 48  |
 			((uint64_t)SEL_KCSEG) << 32);
 	write_msr(MSR_LSTAR, (uint64_t) syscall_entry);
@@ -143,9 +160,6 @@ syscall_init (void) {
 	 * mode stack. Therefore, we masked the FLAG_FL. */
 	write_msr(MSR_SYSCALL_MASK,
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
-
-	lock_init(&filesys_lock);
-	
 }
 
 /* The main system call interface */
@@ -154,6 +168,7 @@ syscall_handler (struct intr_frame *f UNUSED) {
 	// TODO: Your implementation goes here.
 	
 	thread_current()->rsp_stack = f->rsp; // syscall을 호출한 유저 프로그램의 유저 스택 포인터
+	thread_current()->in_syscall = true;  // 끝날 때까지 ksmd가 이 프로세스의 페이지를 합치지 않는다
 
 	uint64_t syscall_no = f->R.rax;  // 콜 넘버
 
@@ -243,11 +258,24 @@ syscall_handler (struct intr_frame *f UNUSED) {
 			munmap_syscall(f->R.rdi);
 			break;
 
+		case SYS_MADVISE :
+			f->R.rax = madvise_syscall(f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+
+		case SYS_MSYNC :
+			f->R.rax = msync_syscall(f->R.rdi, f->R.rsi);
+			break;
+
+		case SYS_BRK :
+			f->R.rax = brk_syscall(f->R.rdi);
+			break;
+
 		default:
 			exit_syscall(-1);
 			break;
 
 	}
+	thread_current()->in_syscall = false;
 	
 }
 // printf ("system call!\n");
@@ -476,7 +504,7 @@ mmap_syscall (void *addr, size_t length, int writable, int fd, off_t offset) {
 	if (pg_round_down(addr) != addr || is_kernel_vaddr(addr))
 		return NULL;
 
-	if (fd == 0 || fd == 1){
+	if (!(writable & MAP_ANONYMOUS) && (fd == 0 || fd == 1)){
 		exit_syscall(-1);
 	}
 	/*  if the range of pages mapped overlaps any existing set of mapped pages */
@@ -486,6 +514,10 @@ mmap_syscall (void *addr, size_t length, int writable, int fd, off_t offset) {
 	/* addr가 NULL(0), 파일의 길이가 0*/
 	if (addr == NULL || (long long)length <= 0)
 		return NULL;
+
+	/* 익명 매핑은 파일 없이 0으로 채워진 메모리이다. fd와 offset은 보지 않는다. */
+	if (writable & MAP_ANONYMOUS)
+		return do_mmap(addr, length, writable & ~MAP_ANONYMOUS, NULL, 0);
 	
 	/* file descriptors representing console input and output are not mappable */
 	struct file *file = fd_to_struct_filep(fd);
@@ -505,4 +537,33 @@ munmap_syscall(void *addr){
 	do_munmap(addr);
 }
 
+/* 페이지 정렬된 유저 영역 [addr, addr + length)에 대한 접근 패턴 힌트.
+   성공하면 0, 인자가 잘못되었으면 -1. */
+int
+madvise_syscall (void *addr, size_t length, int advice) {
+	if (pg_ofs(addr) != 0 || length == 0 || addr + length < addr
+			|| !is_user_vaddr(addr) || !is_user_vaddr(addr + length - 1))
+		return -1;
+	return do_madvise(addr, length, advice) ? 0 : -1;
+}
+
+/* 프로그램 break를 addr로 옮긴다. addr가 NULL이면 지금 break만 알려 준다.
+   새 break를 돌려주고, 옮길 수 없으면 원래 break를 돌려준다. */
+void *
+brk_syscall (void *addr) {
+	if (addr != NULL)
+		do_brk(addr);
+	return thread_current()->brk;
+}
+
+/* mmap 영역 [addr, addr + length)의 더티 페이지를 지금 파일에 쓴다.
+   성공하면 0, 범위가 잘못되었거나 매핑되지 않은 곳이 있으면 -1. */
+int
+msync_syscall (void *addr, size_t length) {
+	if (pg_ofs(addr) != 0 || length == 0 || addr + length < addr
+			|| !is_user_vaddr(addr) || !is_user_vaddr(addr + length - 1))
+		return -1;
+	return do_msync(addr, length) ? 0 : -1;
+}
+
 
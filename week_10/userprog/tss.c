@@ -2,6 +2,7 @@
 #include <debug.h>
 #include <stddef.h>
 #include "userprog/gdt.h"
+#include "threads/cpu.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
 #include "threads/vaddr.h"
@@ -45,22 +46,26 @@
  *      stack pointer to point to the new thread's kernel stack.
  *      (The call is in schedule in thread.c.) */
 
-/* Kernel TSS. */
-struct task_state *tss;
-
-/* Initializes the kernel TSS. */
+/* Initializes the running CPU's TSS.  The BSP allocates its own;
+   smp_init() allocates one for each application processor before
+   starting it, because an AP runs this from its idle thread,
+   which must not block on the allocator's lock. */
 void
 tss_init (void) {
+	struct cpu *c = cpu_current ();
+
 	/* Our TSS is never used in a call gate or task gate, so only a
 	 * few fields of it are ever referenced, and those are the only
 	 * ones we initialize. */
-	tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	if (c->tss == NULL)
+		c->tss = palloc_get_page (PAL_ASSERT | PAL_ZERO);
 	tss_update (thread_current ());
 }
 
-/* Returns the kernel TSS. */
+/* Returns the running CPU's TSS. */
 struct task_state *
 tss_get (void) {
+	struct task_state *tss = cpu_current ()->tss;
 	ASSERT (tss != NULL);
 	return tss;
 }
@@ -70,6 +75,5 @@ tss_get (void) {
 /* 스레드 스택의 끝을 가리키도록 TSS의 링 0 스택 포인터를 설정합니다. */
 void
 tss_update (struct thread *next) {
-	ASSERT (tss != NULL);
-	tss->rsp0 = (uint64_t) next + PGSIZE;
+	tss_get ()->rsp0 = (uint64_t) next + PGSIZE;
 }
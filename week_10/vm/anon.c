@@ -1,9 +1,15 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <stdio.h>
+#include <round.h>
+#include <string.h>
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #include "devices/disk.h"
 #include "threads/vaddr.h"
 #include "kernel/bitmap.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -15,6 +21,53 @@ static void anon_destroy (struct page *page);
 struct bitmap *swap_table;
 const size_t SECTORS_PER_PAGE = PGSIZE / DISK_SECTOR_SIZE;  // sectors / page
 
+/* 스왑 슬롯마다 그 슬롯을 가리키는 페이지 수.
+   fork 이후 공유(COW) 중이던 프레임이 쫓겨나면 여러 페이지가 한 슬롯을 같이 쓴다. */
+static unsigned *swap_slot_cnt;
+static void swap_slot_put (int page_no);
+
+/* 스왑 슬롯 할당기.
+   슬롯을 SWAP_CLUSTER개씩 묶은 클러스터마다 빈 슬롯 수를 세어 두고,
+   마지막으로 할당한 클러스터(cursor)부터 다음 빈 클러스터를 찾는다(next-fit).
+   같은 프로세스가 연달아 내보내는 페이지는 바로 옆 슬롯에 넣어서
+   나중에 다시 읽을 때 디스크를 순서대로 읽게 한다. */
+#define SWAP_CLUSTER 16
+static size_t swap_slot_total;		/* 전체 슬롯 수 */
+static size_t swap_slot_free;		/* 빈 슬롯 수 */
+static size_t swap_cluster_cnt;
+static uint8_t *cluster_free;		/* 클러스터마다 빈 슬롯 수 */
+static size_t cluster_empty_cnt;	/* 통째로 비어 있는 클러스터 수 */
+static size_t cluster_cursor;		/* next-fit 커서 (클러스터 번호) */
+static struct thread *last_owner;	/* 마지막으로 슬롯을 받은 프로세스 */
+static size_t last_slot;			/* 그 프로세스가 받은 슬롯 */
+static long long swap_probe_cnt;	/* 할당하면서 살펴본 클러스터 수 */
+static struct lock swap_lock;		/* 위 할당기 상태와 swap_slot_cnt를 보호 */
+static size_t cluster_size (size_t c);
+
+/* 슬롯마다 그 슬롯에 내보낸 페이지. 슬롯을 여러 페이지가 공유하면 NULL.
+   미리 읽기(read-ahead)가 이웃 슬롯의 주인을 찾을 때 쓴다. */
+static struct page **slot_page;
+
+/* 스왑 미리 읽기.
+   폴트가 난 페이지 바로 뒤 슬롯들이 같은 프로세스의 페이지이고 아직 스왑되어
+   있으면 창(window) 크기만큼 한 번에 순서대로 읽어 바로 매핑해 둔다.
+   다음 폴트 때 지난번에 미리 읽은 페이지가 실제로 쓰였는지(accessed 비트) 보고
+   절반 이상 쓰였으면 창을 두 배로, 하나도 안 쓰였으면 절반으로 줄인다. */
+#define RA_MAX 16
+static int ra_window = 4;			/* 다음에 미리 읽을 페이지 수 */
+static struct thread *ra_owner;		/* 지난번에 미리 읽은 프로세스 */
+static struct page *ra_batch[RA_MAX];	/* 지난번에 미리 읽은 페이지들 */
+static int ra_batch_cnt;
+static void anon_readahead (struct page *page, int page_no);
+
+/* 스왑 통계. */
+static long long swap_in_cnt;	/* 스왑 디스크에서 읽어 온 페이지 수 */
+static long long swap_out_cnt;	/* 스왑 디스크에 쓴 페이지 수 */
+static long long ra_read_cnt;	/* 미리 읽은 페이지 수 */
+static long long ra_hit_cnt;	/* 미리 읽은 페이지 중 실제로 쓰인 수 */
+static long long clean_cnt;		/* 쫓겨나기 전에 미리 써 둔 페이지 수 */
+static long long clean_hit_cnt;	/* 미리 써 둔 덕분에 쫓아낼 때 쓰지 않은 페이지 수 */
+
 /* DO NOT MODIFY this struct */
 static const struct page_operations anon_ops = {
 	.swap_in = anon_swap_in,
@@ -30,6 +83,92 @@ vm_anon_init (void) {
 	swap_disk = disk_get(1, 1); 
     size_t swap_size = disk_size(swap_disk) / SECTORS_PER_PAGE;  
     swap_table = bitmap_create(swap_size);
+    swap_slot_cnt = calloc(swap_size, sizeof *swap_slot_cnt);
+    slot_page = calloc(swap_size, sizeof *slot_page);
+
+    swap_slot_total = swap_slot_free = swap_size;
+    swap_cluster_cnt = DIV_ROUND_UP (swap_size, SWAP_CLUSTER);
+    cluster_free = malloc (swap_cluster_cnt);
+    for (size_t c = 0; c < swap_cluster_cnt; c++)
+        cluster_free[c] = cluster_size (c);
+    cluster_empty_cnt = swap_cluster_cnt;
+    cluster_cursor = 0;
+    last_owner = NULL;
+    lock_init (&swap_lock);
+
+    size_t user_pages;
+    palloc_user_pool (&user_pages);
+    zswap_init (swap_disk, swap_size, user_pages);
+}
+
+/* 클러스터 C에 들어 있는 슬롯 수. 마지막 클러스터만 작을 수 있다. */
+static size_t
+cluster_size (size_t c) {
+	size_t first = c * SWAP_CLUSTER;
+
+	return swap_slot_total - first < SWAP_CLUSTER ? swap_slot_total - first : SWAP_CLUSTER;
+}
+
+static void
+slot_mark (size_t slot) {
+	size_t c = slot / SWAP_CLUSTER;
+
+	bitmap_mark (swap_table, slot);
+	if (cluster_free[c]-- == cluster_size (c))
+		cluster_empty_cnt--;
+	swap_slot_free--;
+}
+
+/* OWNER의 페이지를 넣을 빈 슬롯을 하나 잡는다. 빈 슬롯이 없으면 -1.
+   swap_lock을 잡고 불러야 한다. */
+static int
+swap_slot_alloc (struct thread *owner) {
+	size_t slot;
+
+	if (swap_slot_free == 0)
+		return -1;
+
+	/* 같은 프로세스가 연달아 내보내면 바로 다음 슬롯을 준다. */
+	if (owner == last_owner && last_slot + 1 < swap_slot_total
+			&& !bitmap_test (swap_table, last_slot + 1)) {
+		slot = last_slot + 1;
+		goto found;
+	}
+
+	/* 새로 시작하는 묶음은 통째로 빈 클러스터에 넣어야 뒤따르는 페이지가 옆에 붙는다.
+	   그런 클러스터가 없으면 빈 슬롯이 있는 아무 클러스터나 쓴다. */
+	for (int pass = cluster_empty_cnt > 0 ? 0 : 1; pass < 2; pass++)
+		for (size_t i = 0; i < swap_cluster_cnt; i++) {
+			size_t c = (cluster_cursor + i) % swap_cluster_cnt;
+
+			swap_probe_cnt++;
+			if (cluster_free[c] == 0
+					|| (pass == 0 && cluster_free[c] != cluster_size (c)))
+				continue;
+			cluster_cursor = c;
+			slot = bitmap_scan (swap_table, c * SWAP_CLUSTER, 1, false);
+			goto found;
+		}
+	NOT_REACHED ();
+
+found:
+	slot_mark (slot);
+	last_owner = owner;
+	last_slot = slot;
+	return slot;
+}
+
+/* SLOT을 비운다. swap_lock을 잡고 불러야 한다. */
+static void
+swap_slot_release (size_t slot) {
+	size_t c = slot / SWAP_CLUSTER;
+
+	bitmap_reset (swap_table, slot);
+	slot_page[slot] = NULL;
+	zswap_invalidate (slot);
+	if (++cluster_free[c] == cluster_size (c))
+		cluster_empty_cnt++;
+	swap_slot_free++;
 }
 
 /* Initialize the file mapping */
@@ -44,10 +183,14 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	//해당 페이지는 ANON이므로 operations도 anon으로 지정
 	page->operations = &anon_ops;
 
+	/* 채워 줄 init이 없는 익명 페이지는 0으로 채워진 페이지로 시작한다. */
+	if (page->uninit.init == NULL)
+		memset (kva, 0, PGSIZE);
+
 	struct anon_page *anon_page = &page->anon;
-	// anon_page->swap_index = -1; // -1로 초기화 
+	anon_page->swap_index = -1; // -1로 초기화 
 	
-	// return true;
+	return true;
 }
 
 /* Swap in the page by read contents from the swap disk. */
@@ -59,54 +202,296 @@ anon_swap_in (struct page *page, void *kva) {
 	int page_no = anon_page->swap_index;
 
 	/* 스왑 테이블에서 해당 스왑 슬롯이 진짜 사용 중인지 체크  */
-    if (bitmap_test(swap_table, page_no) == false) {
+    if (page_no < 0 || bitmap_test(swap_table, page_no) == false) {
         return false;
     }
 
-	/* 해당 스왑 영역의 데이터를 가상 주소 공간 kva에 써 준다. */
-    for (int i = 0; i < SECTORS_PER_PAGE; ++i) {
-        disk_read(swap_disk, page_no * SECTORS_PER_PAGE + i, kva + DISK_SECTOR_SIZE * i);
+	/* 해당 스왑 영역의 데이터를 가상 주소 공간 kva에 써 준다.
+	   압축 캐시에 있으면 디스크를 읽지 않는다. */
+    if (!zswap_load(page_no, kva)) {
+        for (int i = 0; i < SECTORS_PER_PAGE; ++i) {
+            disk_read(swap_disk, page_no * SECTORS_PER_PAGE + i, kva + DISK_SECTOR_SIZE * i);
+        }
     }
 
-	/* 다시 해당 스왑 슬롯을 false로 만들어준다. */
-    bitmap_set(swap_table, page_no, false);
-    
+	/* 이 슬롯을 쓰는 페이지가 더 없으면 다시 해당 스왑 슬롯을 false로 만들어준다. */
+    lock_acquire(&swap_lock);
+    swap_in_cnt++;
+    swap_slot_put(page_no);
+    lock_release(&swap_lock);
+    anon_page->swap_index = -1;
+
+    anon_readahead(page, page_no);
     return true;
 }
 
+/* 지난번에 미리 읽은 페이지 중 몇 개가 쓰였는지 보고 창 크기를 조절한다.
+   swap_lock을 잡고 불러야 한다. */
+static void
+readahead_feedback (struct thread *owner) {
+	int hits = 0;
+
+	/* 지난번에 미리 읽은 것이 없으면 판단할 근거도 없다. */
+	if (owner != ra_owner || ra_batch_cnt == 0) {
+		ra_batch_cnt = 0;
+		return;
+	}
+	for (int i = 0; i < ra_batch_cnt; i++) {
+		struct page *p = ra_batch[i];
+		if (p != NULL && p->frame != NULL && pml4_is_accessed(owner->pml4, p->va))
+			hits++;
+	}
+	ra_hit_cnt += hits;
+	if (hits * 2 >= ra_batch_cnt)
+		ra_window = ra_window * 2 < RA_MAX ? ra_window * 2 : RA_MAX;
+	else if (hits == 0)
+		ra_window = ra_window / 2 > 1 ? ra_window / 2 : 1;
+	ra_batch_cnt = 0;
+}
+
+/* PAGE(슬롯 PAGE_NO)를 읽어 온 직후에 부른다.
+   바로 뒤 슬롯부터 같은 프로세스의 스왑된 페이지가 이어지는 만큼(최대 창 크기)
+   빈 프레임을 받아 디스크에서 연속으로 읽고 매핑한다.
+   빈 프레임이 넉넉하지 않으면 다른 페이지를 쫓아내면서까지 읽지는 않는다. */
+static void
+anon_readahead (struct page *page, int page_no) {
+	struct thread *owner = page->owner;
+	struct page *pages[RA_MAX];
+	struct frame *frames[RA_MAX];
+	int cnt = 0;
+
+	/* prefetchd가 대신 읽을 때는 주인의 다른 페이지를 건드리지 않는다. */
+	if (owner != thread_current())
+		return;
+
+	lock_acquire(&swap_lock);
+	readahead_feedback(owner);
+	for (size_t slot = page_no + 1; cnt < ra_window && slot < swap_slot_total; slot++) {
+		struct page *p = slot_page[slot];
+		if (p == NULL || p->owner != owner || p->frame != NULL
+				|| p->anon.swap_index != (int) slot || swap_slot_cnt[slot] != 1)
+			break;
+		pages[cnt++] = p;
+	}
+	lock_release(&swap_lock);
+
+	for (int i = 0; i < cnt; i++) {
+		frames[i] = vm_get_free_frame();
+		if (frames[i] == NULL) {
+			cnt = i;
+			break;
+		}
+	}
+
+	/* 슬롯이 이어져 있으므로 섹터를 처음부터 끝까지 한 번에 읽는다. */
+	for (int i = 0; i < cnt; i++) {
+		if (zswap_load(page_no + 1 + i, frames[i]->kva))
+			continue;
+		for (int j = 0; j < SECTORS_PER_PAGE; ++j)
+			disk_read(swap_disk, (page_no + 1 + i) * SECTORS_PER_PAGE + j,
+					frames[i]->kva + DISK_SECTOR_SIZE * j);
+	}
+
+	for (int i = 0; i < cnt; i++) {
+		struct page *p = pages[i];
+		int slot = p->anon.swap_index;
+
+		if (!vm_install_frame(p, frames[i]))
+			continue;
+		lock_acquire(&swap_lock);
+		swap_slot_put(slot);
+		p->anon.swap_index = -1;
+		ra_owner = owner;
+		ra_batch[ra_batch_cnt++] = p;
+		ra_read_cnt++;
+		lock_release(&swap_lock);
+	}
+}
+
+/* KVA의 한 페이지를 스왑 슬롯 PAGE_NO에 쓴다.
+   한 페이지를 디스크에 써 주기 위해 SECTORS_PER_PAGE개의 섹터에 저장해야 한다.
+   이 때 디스크에 각 섹터의 크기 DISK_SECTOR_SIZE만큼 써 준다.
+   압축 캐시에 들어가면 디스크에는 나중에 캐시가 찼을 때 쓴다. */
+static void
+swap_write (int page_no, const void *kva) {
+    if (!zswap_store(page_no, kva)) {
+        for (int i = 0; i < SECTORS_PER_PAGE; ++i) {
+            disk_write(swap_disk, page_no * SECTORS_PER_PAGE + i, kva + DISK_SECTOR_SIZE * i);
+        }
+    }
+}
+
 /* Swap out the page by writing contents to the swap disk. */
+/* 백그라운드 청소(anon_swap_clean)로 frame->swap_slot에 써 둔 내용이 있고
+   그 뒤로 아무도 쓰지 않았으면 디스크에 다시 쓰지 않고 그 슬롯을 쓴다. */
 static bool 
 anon_swap_out (struct page *page) {
-	struct anon_page *anon_page = &page->anon;
+	struct frame *frame = page->frame;
+	int page_no = frame->swap_slot;
+	bool dirty = frame->dirty;
 
-	/* 비트맵을 처음부터 순회해 false 값을 가진 비트를 하나 찾는다.
-	   즉, 페이지를 할당받을 수 있는 swap slot을 하나 찾는다. */
-	int page_no = bitmap_scan(swap_table, 0, 1, false);
+	/* 페이지를 저장할 수 있는 swap slot을 하나 찾는다. */
+	if (page_no < 0) {
+		lock_acquire(&swap_lock);
+		page_no = swap_slot_alloc(page->owner);
+		lock_release(&swap_lock);
+	}
 
-    if (page_no == BITMAP_ERROR) {
+    if (page_no < 0) {
         return false;
     }
 
-	/* 한 페이지를 디스크에 써 주기 위해 SECTORS_PER_PAGE개의 섹터에 저장해야 한다.
-	   이 때 디스크에 각 섹터의 크기 DISK_SECTOR_SIZE만큼 써 준다. */
-    for (int i = 0; i < SECTORS_PER_PAGE; ++i) {
-        disk_write(swap_disk, page_no * SECTORS_PER_PAGE + i, page->va + DISK_SECTOR_SIZE * i);
-    }
+	/* 쓰는 동안 내용이 바뀌지 않게 이 프레임을 공유하는 모든 페이지의 PTE에서
+	   Present Bit을 먼저 0으로 바꿔준다. 그 사이에 접근하면 Page Fault가 나고
+	   폴트 처리는 쓰기가 끝날 때까지(frame->io) 기다린다. */
+	for (struct list_elem *e = list_begin (&frame->pages); e != list_end (&frame->pages);
+			e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, share_elem);
+		pml4_clear_page(p->owner->pml4, p->va);
+		if (pml4_is_dirty(p->owner->pml4, p->va))
+			dirty = true;
+	}
 
-	/* swap table의 해당 페이지에 대한 swap slot의 비트를 TRUE로 바꿔주고,
-	   해당 페이지의 PTE에서 Present Bit을 0으로 바꿔준다.
-	   이제 프로세스가 이 페이지에 접근하면 Page Fault가 뜬다.  */
-    bitmap_set(swap_table, page_no, true);
-    pml4_clear_page(thread_current()->pml4, page->va);
+	/* page->va는 현재 스레드의 주소 공간이 아닐 수 있으므로 커널 주소(kva)로 쓴다.
+	   미리 써 둔 내용이 낡았으면 압축 캐시에 남은 것을 지우고 같은 슬롯에 다시 쓴다. */
+	if (frame->swap_slot < 0 || dirty) {
+		if (frame->swap_slot >= 0)
+			zswap_invalidate(page_no);
+		swap_write(page_no, frame->kva);
+		swap_out_cnt++;
+	}
+	else
+		clean_hit_cnt++;
 
-	/* 페이지의 swap_index 값을 이 페이지가 저장된 swap slot의 번호로 써 준다. */
-    anon_page->swap_index = page_no;
+	/* 이 프레임을 공유하던 모든 페이지가 같은 swap slot을 가리키게 한다.
+	   미리 써 둔 슬롯이었으면 프레임이 들고 있던 몫은 내려놓는다. */
+	lock_acquire(&swap_lock);
+	slot_page[page_no] = list_front (&frame->pages) == list_back (&frame->pages) ? page : NULL;
+	while (!list_empty (&frame->pages)) {
+		struct page *p = list_entry (list_pop_front (&frame->pages), struct page, share_elem);
+		p->anon.swap_index = page_no;
+		p->frame = NULL;
+		swap_slot_cnt[page_no]++;
+	}
+	if (frame->swap_slot >= 0)
+		swap_slot_put(page_no);
+	lock_release(&swap_lock);
+	frame->swap_slot = -1;
+	frame->page = NULL;
 
     return true;
 }
 
+/* 메모리에 있는 FRAME의 내용을 쫓겨나기 전에 미리 스왑 슬롯에 써 둔다 (WSClock의 청소).
+   슬롯은 프레임이 들고 있다가, 그 뒤로 PTE가 더티가 되지 않은 채 쫓겨나면
+   anon_swap_out()이 디스크에 다시 쓰지 않고 그대로 쓴다. 프레임이 그냥 해제되면
+   anon_swap_forget()이 돌려준다.
+   호출한 쪽이 프레임을 고정하고(frame->io) 더티 비트를 지운 뒤 frame_lock 없이 부른다.
+   내용을 담은 슬롯을 돌려주고, 쓰지 않았으면 -1.
+   스왑이 절반 넘게 차 있으면 새 슬롯은 쫓겨나는 페이지를 위해 남겨 둔다. */
+int
+anon_swap_clean (struct frame *frame) {
+	int page_no = frame->swap_slot;
+
+	if (page_no < 0) {
+		lock_acquire(&swap_lock);
+		if (swap_slot_free * 2 >= swap_slot_total
+				&& (page_no = swap_slot_alloc(frame->owner)) >= 0)
+			swap_slot_cnt[page_no] = 1;
+		lock_release(&swap_lock);
+		if (page_no < 0)
+			return -1;
+	}
+	else
+		zswap_invalidate(page_no);
+
+	swap_write(page_no, frame->kva);
+	clean_cnt++;
+	return page_no;
+}
+
+/* 쫓겨나지 않고 해제되는 FRAME이 미리 써 둔 슬롯을 돌려준다.
+   frame_lock을 잡고 불러야 한다. */
+void
+anon_swap_forget (struct frame *frame) {
+	if (frame->swap_slot < 0)
+		return;
+	lock_acquire(&swap_lock);
+	swap_slot_put(frame->swap_slot);
+	lock_release(&swap_lock);
+	frame->swap_slot = -1;
+}
+
+/* 자식 페이지가 부모와 같은 스왑 슬롯을 공유하게 한다. (fork 시 스왑되어 있던 페이지) */
+void
+anon_swap_ref (struct page *page) {
+	int page_no = page->anon.swap_index;
+
+	if (page_no >= 0) {
+		lock_acquire(&swap_lock);
+		swap_slot_cnt[page_no]++;
+		slot_page[page_no] = NULL;
+		lock_release(&swap_lock);
+	}
+}
+
+/* 슬롯을 쓰는 페이지 하나가 빠졌다. 아무도 안 쓰면 슬롯을 비운다.
+   swap_lock을 잡고 불러야 한다. */
+static void
+swap_slot_put (int page_no) {
+	ASSERT (swap_slot_cnt[page_no] > 0);
+	if (--swap_slot_cnt[page_no] == 0)
+		swap_slot_release(page_no);
+}
+
+/* 슬롯 할당기 성능 측정용 (tests/threads/swap-slot-bench.c).
+   OWNER 명의로 슬롯을 하나 잡거나 돌려주고, 지금까지 살펴본 클러스터 수를 알려준다. */
+int
+anon_slot_alloc (struct thread *owner) {
+	int slot;
+
+	lock_acquire(&swap_lock);
+	slot = swap_slot_alloc(owner);
+	lock_release(&swap_lock);
+	return slot;
+}
+
+void
+anon_slot_release (int slot) {
+	lock_acquire(&swap_lock);
+	swap_slot_release(slot);
+	lock_release(&swap_lock);
+}
+
+long long
+anon_slot_probes (void) {
+	return swap_probe_cnt;
+}
+
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* 메모리에 있으면 프레임에서 떼어내고, 스왑되어 있으면 슬롯을 돌려준다.
+	   떼어낸 뒤로는 쫓겨나지 않으므로 swap_index를 그 다음에 본다. */
+	frame_detach (page);
+	lock_acquire (&swap_lock);
+	for (int i = 0; i < ra_batch_cnt; i++)
+		if (ra_batch[i] == page)
+			ra_batch[i] = NULL;
+	if (anon_page->swap_index >= 0)
+		swap_slot_put (anon_page->swap_index);
+	lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+anon_print_stats (void) {
+	printf ("Swap: %lld swap-ins, %lld swap-outs\n", swap_in_cnt, swap_out_cnt);
+	printf ("Swap read-ahead: %lld pages read, %lld used, window %d\n",
+			ra_read_cnt, ra_hit_cnt, ra_window);
+	printf ("Swap clean: %lld pages written ahead, %lld evicted without a write\n",
+			clean_cnt, clean_hit_cnt);
+	zswap_print_stats ();
 }
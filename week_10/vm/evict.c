@@ -0,0 +1,392 @@
+/* evict.c: Page replacement policies.
+   clock, WSClock, 2Q(LRU-2 근사), ARC(CAR) 중 하나를 커널 명령줄에서 골라 쓴다.
+   하드웨어는 접근할 때마다 알려주지 않으므로 모든 정책은 희생자를 찾을 때
+   각 프레임의 accessed 비트를 확인(frame_test_and_clear_accessed)하는 방식으로
+   참조 여부를 알아낸다. 그래서 LRU-2는 2Q로, ARC는 CAR(Clock with Adaptive
+   Replacement)로 구현했다. */
+
+#include "vm/evict.h"
+#include <stdio.h>
+#include <string.h>
+#include "vm/vm.h"
+#include "devices/timer.h"
+
+static struct frame *table;		/* 프레임 테이블 (vm.c 소유) */
+static size_t table_cnt;
+static size_t hand;				/* clock/WSClock 바늘 */
+
+/* 교체 통계. */
+static long long evict_cnt;		/* 쫓아낸 프레임 수 */
+static long long scan_cnt;		/* 희생자를 찾으면서 살펴본 프레임 수 */
+
+/* 2Q와 ARC가 쓰는 프레임 큐와 ghost(쫓겨난 페이지의 이력) 큐.
+   frame->queue와 page->ghost에는 (인덱스 + 1)을 넣고, 0은 어디에도 없다는 뜻. */
+struct frame_queue {
+	struct list list;
+	size_t cnt;
+};
+static struct frame_queue fq[2];	/* 2Q: A1in, Am / ARC: T1, T2 */
+static struct frame_queue gq[2];	/* 2Q: A1out / ARC: B1, B2 */
+
+static size_t arc_p;			/* ARC가 T1에 주려는 목표 크기 */
+
+static void
+queue_init (void) {
+	for (int i = 0; i < 2; i++) {
+		list_init (&fq[i].list);
+		fq[i].cnt = 0;
+		list_init (&gq[i].list);
+		gq[i].cnt = 0;
+	}
+}
+
+static void
+fq_push (int q, struct frame *frame) {
+	list_push_back (&fq[q].list, &frame->lru_elem);
+	fq[q].cnt++;
+	frame->queue = q + 1;
+}
+
+static void
+fq_remove (struct frame *frame) {
+	struct frame_queue *q = &fq[frame->queue - 1];
+
+	list_remove (&frame->lru_elem);
+	q->cnt--;
+	frame->queue = 0;
+}
+
+static struct frame *
+fq_front (int q) {
+	return list_entry (list_front (&fq[q].list), struct frame, lru_elem);
+}
+
+/* 이력을 남기고 KEEP개를 넘으면 가장 오래된 이력부터 버린다. */
+static void
+gq_push (int q, struct page *page, size_t keep) {
+	if (keep == 0)
+		return;
+	while (gq[q].cnt >= keep) {
+		struct page *old = list_entry (list_pop_front (&gq[q].list), struct page, ghost_elem);
+		old->ghost = 0;
+		gq[q].cnt--;
+	}
+	list_push_back (&gq[q].list, &page->ghost_elem);
+	gq[q].cnt++;
+	page->ghost = q + 1;
+}
+
+static void
+gq_remove (struct page *page) {
+	if (page->ghost == 0)
+		return;
+	list_remove (&page->ghost_elem);
+	gq[page->ghost - 1].cnt--;
+	page->ghost = 0;
+}
+
+static void
+gq_pop_front (int q) {
+	if (gq[q].cnt > 0)
+		gq_remove (list_entry (list_front (&gq[q].list), struct page, ghost_elem));
+}
+
+static void
+queue_remove (struct frame *frame) {
+	if (frame->queue != 0)
+		fq_remove (frame);
+}
+
+static void
+queue_forget (struct page *page) {
+	gq_remove (page);
+}
+
+/* 정책이 프레임 하나를 살펴본다. 마지막 확인 이후 접근되었으면 true. */
+static bool
+referenced (struct frame *frame) {
+	scan_cnt++;
+	return frame_test_and_clear_accessed (frame);
+}
+
+/* 쫓아낼 수 없는 프레임 (비어 있거나 고정됨) */
+static bool
+unevictable (struct frame *frame) {
+	return frame->page == NULL || frame->pin_cnt > 0 || frame->huge;
+}
+
+/* clock(second chance).
+   프레임 테이블 배열을 그대로 원형 큐로 보고 바늘을 돌린다. */
+static void
+clock_init (struct frame *t UNUSED, size_t cnt UNUSED) {
+	hand = 0;
+}
+
+static struct frame *
+clock_get_victim (void) {
+	/* 바늘을 최대 두 바퀴 돌린다. 첫 바퀴에서 accessed 비트를 지우므로
+	   고정(pin)되지 않은 프레임이 하나라도 있으면 두 번째 바퀴에서 고를 수 있다. */
+	for (size_t i = 0; i < 2 * table_cnt; i++) {
+		struct frame *victim = &table[hand];
+		hand = (hand + 1) % table_cnt;
+
+		if (unevictable (victim))
+			continue;
+		if (!referenced (victim))
+			return victim;
+	}
+	return NULL;
+}
+
+/* WSClock.
+   최근 WS_TAU tick 안에 쓰인 프레임은 작업 집합(working set)에 있다고 보고 남긴다.
+   작업 집합 밖의 프레임 중에서는 디스크에 쓰지 않고 버릴 수 있는(깨끗한) 프레임을
+   먼저 고른다. 더티인 프레임은 지나가면서 cleand에게 미리 써 두게 맡기고
+   (frame_start_clean) 다음 바퀴에 깨끗해져 있으면 그때 고른다.
+   한 바퀴 안에 깨끗한 프레임이 없으면 가장 오래 안 쓰인 프레임을 고른다. */
+#define WS_TAU 50
+
+static struct frame *
+wsclock_get_victim (void) {
+	int64_t now = timer_ticks ();
+	struct frame *oldest = NULL;
+
+	for (size_t i = 0; i < 2 * table_cnt; i++) {
+		struct frame *f = &table[hand];
+		hand = (hand + 1) % table_cnt;
+
+		if (unevictable (f) || referenced (f))
+			continue;
+		if (now - f->last_used > WS_TAU) {
+			if (!frame_is_dirty (f))
+				return f;
+			frame_start_clean (f);
+		}
+		if (oldest == NULL || f->last_used < oldest->last_used)
+			oldest = f;
+		if (i + 1 >= table_cnt)
+			return oldest;
+	}
+	return oldest;
+}
+
+/* 2Q (LRU-2 근사).
+   처음 들어온 페이지는 A1in(FIFO)에서 시험 기간을 거친다. 그 동안 다시 참조되면
+   (두 번째 참조) 본 큐 Am으로 올라가고, 아니면 쫓겨나며 A1out에 이력을 남긴다.
+   A1out에 이력이 있는 페이지가 다시 들어오면 바로 Am으로 간다.
+   한 번 훑고 지나가는 순차 접근이 자주 쓰는 페이지를 밀어내지 못한다. */
+enum { A1IN, AM };
+#define A1OUT 0
+
+static size_t twoq_kin;		/* A1in 목표 크기 (1/4) */
+static size_t twoq_kout;	/* A1out 이력 수 (1/2) */
+
+static void
+twoq_init (struct frame *t UNUSED, size_t cnt) {
+	queue_init ();
+	twoq_kin = cnt / 4 > 0 ? cnt / 4 : 1;
+	twoq_kout = cnt / 2;
+}
+
+static void
+twoq_insert (struct frame *frame) {
+	struct page *page = frame->page;
+
+	if (page->ghost == A1OUT + 1) {
+		gq_remove (page);
+		fq_push (AM, frame);
+	}
+	else
+		fq_push (A1IN, frame);
+}
+
+static struct frame *
+twoq_get_victim (void) {
+	for (size_t i = 0; i < 3 * table_cnt; i++) {
+		bool from_a1in = fq[A1IN].cnt > twoq_kin || fq[AM].cnt == 0;
+		int q = from_a1in ? A1IN : AM;
+		struct frame *f;
+
+		if (fq[q].cnt == 0)
+			return NULL;
+		f = fq_front (q);
+		fq_remove (f);
+
+		if (f->pin_cnt > 0)
+			fq_push (q, f);
+		else if (referenced (f))
+			fq_push (AM, f);
+		else {
+			if (from_a1in)
+				gq_push (A1OUT, f->page, twoq_kout);
+			return f;
+		}
+	}
+	return NULL;
+}
+
+/* ARC, CAR(Clock with Adaptive Replacement)로 구현.
+   T1은 한 번 참조된 페이지, T2는 두 번 이상 참조된 페이지의 clock이다.
+   B1/B2는 T1/T2에서 쫓겨난 페이지의 이력이고, B1에서 다시 불려 오면
+   T1 목표 크기(arc_p)를 늘리고 B2에서 불려 오면 줄여서 최근성과 빈도 사이를
+   워크로드에 맞게 스스로 조절한다. */
+enum { T1, T2 };
+enum { B1, B2 };
+
+static void
+arc_init (struct frame *t UNUSED, size_t cnt UNUSED) {
+	queue_init ();
+	arc_p = 0;
+}
+
+static void
+arc_insert (struct frame *frame) {
+	struct page *page = frame->page;
+	size_t b1 = gq[B1].cnt, b2 = gq[B2].cnt;
+	size_t delta;
+
+	if (page->ghost == B1 + 1) {
+		delta = b2 > b1 ? b2 / b1 : 1;
+		arc_p = arc_p + delta < table_cnt ? arc_p + delta : table_cnt;
+		gq_remove (page);
+		fq_push (T2, frame);
+		return;
+	}
+	if (page->ghost == B2 + 1) {
+		delta = b1 > b2 ? b1 / b2 : 1;
+		arc_p = arc_p > delta ? arc_p - delta : 0;
+		gq_remove (page);
+		fq_push (T2, frame);
+		return;
+	}
+
+	/* 이력 디렉터리가 캐시 크기의 두 배를 넘지 않게 한다. */
+	if (fq[T1].cnt + b1 >= table_cnt)
+		gq_pop_front (B1);
+	else if (fq[T1].cnt + fq[T2].cnt + b1 + b2 >= 2 * table_cnt)
+		gq_pop_front (B2);
+	fq_push (T1, frame);
+}
+
+static struct frame *
+arc_get_victim (void) {
+	for (size_t i = 0; i < 3 * table_cnt; i++) {
+		size_t target = arc_p > 0 ? arc_p : 1;
+		int q = (fq[T1].cnt >= target || fq[T2].cnt == 0) ? T1 : T2;
+		struct frame *f;
+
+		if (fq[q].cnt == 0)
+			return NULL;
+		f = fq_front (q);
+		fq_remove (f);
+
+		if (f->pin_cnt > 0)
+			fq_push (q, f);
+		else if (referenced (f))
+			fq_push (T2, f);
+		else {
+			gq_push (q == T1 ? B1 : B2, f->page, table_cnt);
+			return f;
+		}
+	}
+	return NULL;
+}
+
+static const struct evict_policy policies[] = {
+	{
+		.name = "clock",
+		.init = clock_init,
+		.get_victim = clock_get_victim,
+	},
+	{
+		.name = "wsclock",
+		.init = clock_init,
+		.get_victim = wsclock_get_victim,
+	},
+	{
+		.name = "2q",
+		.init = twoq_init,
+		.insert = twoq_insert,
+		.remove = queue_remove,
+		.get_victim = twoq_get_victim,
+		.forget = queue_forget,
+	},
+	{
+		.name = "arc",
+		.init = arc_init,
+		.insert = arc_insert,
+		.remove = queue_remove,
+		.get_victim = arc_get_victim,
+		.forget = queue_forget,
+	},
+};
+
+/* 현재 정책. 기본은 clock. */
+static const struct evict_policy *policy = &policies[0];
+
+/* NAME 정책을 고른다. vm_init() 전에 명령줄을 읽으면서 부른다.
+   그런 정책이 없으면 false. */
+bool
+evict_policy_select (const char *name) {
+	for (size_t i = 0; i < sizeof policies / sizeof *policies; i++)
+		if (!strcmp (policies[i].name, name)) {
+			policy = &policies[i];
+			return true;
+		}
+	return false;
+}
+
+void
+evict_init (struct frame *t, size_t cnt) {
+	table = t;
+	table_cnt = cnt;
+	policy->init (t, cnt);
+}
+
+void
+evict_insert (struct frame *frame) {
+	if (policy->insert)
+		policy->insert (frame);
+}
+
+void
+evict_remove (struct frame *frame) {
+	if (policy->remove)
+		policy->remove (frame);
+}
+
+/* 희생자를 고른다. 쫓아낼 수 있는 프레임이 하나도 없으면 NULL. */
+struct frame *
+evict_get_victim (void) {
+	struct frame *victim = policy->get_victim ();
+
+	if (victim != NULL)
+		evict_cnt++;
+	return victim;
+}
+
+/* evict_get_victim()이 고른 FRAME을 내보내지 못했다.
+   2Q와 ARC는 희생자를 고르면서 ghost 이력을 남기므로, 그 이력을 지우고 나서
+   큐에 되돌린다. 그대로 두면 아직 메모리에 있는 페이지가 ghost 적중으로 세어져
+   arc_p가 움직이고 페이지가 Am/T2로 올라간다. */
+void
+evict_cancel (struct frame *frame) {
+	evict_cnt--;
+	evict_forget (frame->page);
+	evict_insert (frame);
+}
+
+void
+evict_forget (struct page *page) {
+	if (policy->forget)
+		policy->forget (page);
+}
+
+/* Prints page replacement statistics. */
+void
+evict_print_stats (void) {
+	long long per_evict = evict_cnt > 0 ? scan_cnt * 100 / evict_cnt : 0;
+
+	printf ("VM: %s policy, %lld evictions, %lld frames scanned (%lld.%02lld per eviction)\n",
+			policy->name, evict_cnt, scan_cnt, per_evict / 100, per_evict % 100);
+}
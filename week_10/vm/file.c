@@ -1,5 +1,9 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
 #include "vm/vm.h"
 #include "threads/vaddr.h"
 #include "userprog/process.h"
@@ -17,6 +21,17 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+size_t file_fault_around = 8;
+
+/* fault-around 통계. */
+static long long around_fault_cnt;	/* 이웃 페이지를 함께 읽은 폴트 수 */
+static long long around_page_cnt;	/* 그렇게 함께 매핑한 이웃 페이지 수 */
+
+/* 내보내기 통계. */
+static long long drop_cnt;		/* 깨끗해서 쓰지 않고 버린 페이지 수 */
+static long long writeback_cnt;	/* 파일에 다시 쓴 페이지 수 */
+static long long drop_behind_cnt;	/* 순차 접근 영역에서 지나간 뒤 바로 내보낸 페이지 수 */
+
 /* The initializer of file vm */
 /* 파일 vm의 초기화 */
 void
@@ -30,6 +45,7 @@ file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
 	/* Set up the handler */
     page -> operations = &file_ops;
 	struct file_page *file_page = &page -> file;
+	return true;
 }
 
 /* Swap in the page by read contents from the file. */
@@ -39,22 +55,8 @@ file_backed_swap_in (struct page *page, void *kva) {
 	if(page==NULL)
 		return false;
 
-	struct container *aux = (struct container *)page->uninit.aux;
-
-	struct file *file = aux->file;
-	off_t offset = aux->offset;
-	size_t page_read_bytes = aux->page_read_bytes;
-	// size_t page_zero_bytes = PGSIZE - page_read_bytes;
-	
-	file_seek (file, offset);
-
-	if(file_read(file, kva, page_read_bytes) != (int)page_read_bytes) {
-		return false;
-	}
-
-	memset(kva + page_read_bytes, 0, PGSIZE - page_read_bytes);
-
-	return true;	
+	/* 쫓겨났던 파일 페이지도 처음 읽을 때처럼 이웃과 함께 읽어 온다. */
+	return file_read_around (page, kva, page->uninit.aux);
 }
 
 /* Swap out the page by writeback contents to the file. */
@@ -66,102 +68,511 @@ file_backed_swap_out (struct page *page) {
         return false;
 
     struct container * aux = (struct container *) page->uninit.aux;
-    
+	struct frame *frame = page->frame;
+	bool dirty = frame->dirty;
+	struct list_elem *e;
+
     // 사용 되었던 페이지(dirty page)인지 체크
-	// 체크 후 수정된 페이지(더티 비트1)는 파일에 업데이트
-	// 이후 더티비트를 0으로 만듬
-    if(pml4_is_dirty(thread_current()->pml4, page->va)){
-        file_write_at(aux->file, page->va, aux->page_read_bytes, aux->offset);
-        pml4_set_dirty (thread_current()->pml4, page->va, 0);
-    }
+	// 프레임을 공유하는 페이지 중 하나라도 더티면 파일에 업데이트
+	// 쓰는 동안 내용이 바뀌지 않게 present bit를 먼저 0으로 (dirty 비트는 남는다)
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, share_elem);
+		pml4_clear_page (p->owner->pml4, p->va);
+		if (pml4_is_dirty (p->owner->pml4, p->va))
+			dirty = true;
+	}
+	if (dirty) {
+		file_write_at(aux->file, frame->kva, aux->page_read_bytes, aux->offset);
+		writeback_cnt++;
+	}
+	else
+		drop_cnt++;	// 실행 파일 text처럼 깨끗한 페이지는 그냥 버린다
 
-	//present bit를 0으로 
-    pml4_clear_page(thread_current()->pml4, page->va);
+	//공유하던 모든 페이지를 프레임에서 떼어낸다
+	while (!list_empty (&frame->pages)) {
+		struct page *p = list_entry (list_pop_front (&frame->pages), struct page, share_elem);
+		p->frame = NULL;
+	}
+	frame->page = NULL;
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
 	struct file_page *file_page UNUSED = &page->file;
-	// if (page == NULL)
-	// 	return false;
-	
-	// struct container* container = (struct container *)page->uninit.aux;
+	struct container* container = (struct container *)page->uninit.aux;
+
+	/* 수정된 페이지(더티 비트 1)는 파일에 업데이트 해 놓는다. 
+	   그리고 프레임에서 떼어낸다. (present bit도 0이 된다) */
+	if (frame_writeback (page))
+		writeback_cnt++;
+	frame_detach (page);
+	free (container);
+}
+
+/* Q가 PAGE(컨테이너 C) 뒤로 I번째 페이지이고, 아직 메모리에 없으며
+   파일에서 C 바로 뒤에 이어지는 내용이면 Q의 컨테이너를 돌려준다. 아니면 NULL.
+   처음 읽는 페이지(lazy_load_segment를 기다리는 UNINIT)와
+   쫓겨난 파일 페이지가 대상이다. 같은 struct file을 쓰는 페이지만 이으므로
+   한 매핑을 넘어가지 않는다. */
+static struct container *
+around_neighbor (struct page *q, struct container *c, size_t i) {
+	struct container *qc;
+
+	if (q == NULL || q->frame != NULL || pml4_get_page (q->owner->pml4, q->va) != NULL)
+		return NULL;
+	if (VM_TYPE (q->operations->type) == VM_UNINIT) {
+		if (q->uninit.init != lazy_load_segment)
+			return NULL;
+	}
+	else if (VM_TYPE (q->operations->type) != VM_FILE)
+		return NULL;
+
+	qc = q->uninit.aux;
+	if (qc->file != c->file || qc->offset != c->offset + (off_t) (i * PGSIZE))
+		return NULL;
+	/* 파일에서 읽을 것이 없는 페이지는 미리 채우지 않는다 (읽으면 zero 페이지로 충분하다). */
+	if (qc->page_read_bytes == 0)
+		return NULL;
+	/* 다른 프로세스가 이미 읽어 둔 공유 text는 폴트 때 그 프레임을 같이 쓴다. */
+	if (qc->shared && vm_text_cached (qc))
+		return NULL;
+	return qc;
+}
+
+/* 순차로 읽는 영역(MADV_SEQUENTIAL)에서 PAGE보다 창(C->around) 두 개만큼 앞의 페이지들은
+   다시 쓰지 않을 테니 바로 내보낸다. 바로 앞 창은 남겨 두어 조금 되돌아가 읽어도 폴트가 없다. */
+static void
+drop_behind (struct page *page, struct container *c) {
+	size_t n = c->around;
+
+	for (size_t i = n + 1; i <= 2 * n && (uintptr_t) page->va >= i * PGSIZE; i++) {
+		struct page *q = spt_find_page (&page->owner->spt, page->va - i * PGSIZE);
+
+		if (q != NULL && VM_TYPE (q->operations->type) == VM_FILE && q->frame != NULL
+				&& ((struct container *) q->uninit.aux)->file == c->file && vm_page_drop (q))
+			drop_behind_cnt++;
+	}
+}
+
+/* PAGE(컨테이너 C)의 내용을 파일에서 KVA로 읽어 온다.
+   파일에서 바로 이어지는 뒤쪽 페이지들도 아직 메모리에 없으면
+   최대 C->around개까지 빈 프레임을 받아 한 번의 file_read_at()으로 함께 읽고 매핑한다.
+   순차로 훑는 실행 파일의 text나 mmap 영역은 그만큼 폴트가 줄어든다.
+   다른 페이지를 쫓아내면서까지 이웃을 읽지는 않는다.
+   prefetchd가 다른 프로세스의 페이지를 읽을 때는 그 프로세스의 spt를 건드리지 않도록
+   PAGE 하나만 읽는다. */
+bool
+file_read_around (struct page *page, void *kva, struct container *c) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	struct page *pages[FAULT_AROUND_MAX];
+	struct container *conts[FAULT_AROUND_MAX];
+	struct frame *frames[FAULT_AROUND_MAX];
+	bool own = page->owner == thread_current ();
+	size_t n = !own ? 1 : c->around < FAULT_AROUND_MAX ? c->around : FAULT_AROUND_MAX;
+	size_t last = c->page_read_bytes;
+	size_t cnt = 0, buf_pages = 0, read_bytes;
+	uint8_t *buf = NULL;
+
+	if (own && c->drop_behind)
+		drop_behind (page, c);
 
-	// /* 수정된 페이지(더티 비트 1)는 파일에 업데이트 해 놓는다. 
-	// 	그리고 더티 비트를 0으로 만들어둔다. */
-	// if (pml4_is_dirty(thread_current()->pml4, page->va)){
-	// 	file_write_at(container->file, page->va, 
-	// 		container->page_read_bytes, container->offset);
-	// 	pml4_set_dirty(thread_current()->pml4, page->va, 0);
-	// }
+	/* 앞 페이지가 꽉 차 있어야 다음 페이지가 파일에서 바로 이어진다. */
+	while (cnt + 1 < n && last == PGSIZE) {
+		void *va = page->va + (cnt + 1) * PGSIZE;
+		struct page *q = spt_find_page (spt, va);
+		struct container *qc;
 
-	// /* present bit을 0으로 만든다. */
-	// pml4_clear_page(thread_current()->pml4, page->va);
+		/* mmap 영역의 이웃은 아직 페이지가 없을 수 있으므로 여기서 만든다. */
+		if (q == NULL && page_get_type (page) == VM_FILE)
+			q = vma_fault_page (spt, va);
+		qc = around_neighbor (q, c, cnt + 1);
+		if (qc == NULL)
+			break;
+		pages[cnt] = q;
+		conts[cnt] = qc;
+		last = qc->page_read_bytes;
+		cnt++;
+	}
+
+	if (cnt > 0) {
+		buf_pages = cnt + 1;
+		if ((buf = palloc_get_multiple (0, buf_pages)) == NULL)
+			cnt = 0;
+	}
+	for (size_t i = 0; i < cnt; i++)
+		if ((frames[i] = vm_get_free_frame ()) == NULL) {
+			cnt = i;
+			break;
+		}
+
+	if (cnt == 0) {
+		if (buf != NULL)
+			palloc_free_multiple (buf, buf_pages);
+		/* fork한 자식과 같은 file을 공유할 수 있으므로 seek 없이 오프셋을 지정해 읽는다. */
+		if (file_read_at (c->file, kva, c->page_read_bytes, c->offset)
+				!= (int) c->page_read_bytes)
+			return false;
+		memset (kva + c->page_read_bytes, 0, PGSIZE - c->page_read_bytes);
+		return true;
+	}
+
+	read_bytes = cnt * PGSIZE + conts[cnt - 1]->page_read_bytes;
+	if (file_read_at (c->file, buf, read_bytes, c->offset) != (int) read_bytes) {
+		for (size_t i = 0; i < cnt; i++)
+			vm_put_free_frame (frames[i]);
+		palloc_free_multiple (buf, buf_pages);
+		return false;
+	}
+	memcpy (kva, buf, PGSIZE);
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *q = pages[i];
+		const struct page_operations *ops = q->operations;
+		struct uninit_page uninit = q->uninit;
+		size_t bytes = conts[i]->page_read_bytes;
+
+		memcpy (frames[i]->kva, buf + (i + 1) * PGSIZE, bytes);
+		memset (frames[i]->kva + bytes, 0, PGSIZE - bytes);
+
+		/* 처음 읽는 페이지는 uninit_initialize()처럼 타입에 맞게 바꾸되
+		   내용은 이미 채웠으므로 lazy_load_segment()는 부르지 않는다.
+		   매핑하지 못하면 원래대로 되돌려 다음 폴트에서 다시 읽게 한다. */
+		if (VM_TYPE (ops->type) == VM_UNINIT)
+			uninit.page_initializer (q, uninit.type, frames[i]->kva);
+		if (!vm_install_frame (q, frames[i])) {
+			q->operations = ops;
+			q->uninit = uninit;
+			continue;
+		}
+		if (conts[i]->shared)
+			vm_text_register (frames[i], conts[i]);
+		around_page_cnt++;
+	}
+	around_fault_cnt++;
+	palloc_free_multiple (buf, buf_pages);
+	return true;
+}
+
+/* Prints fault-around statistics. */
+void
+file_print_stats (void) {
+	printf ("Fault-around: %lld faults, %lld pages mapped around\n",
+			around_fault_cnt, around_page_cnt);
+	printf ("File: %lld clean pages dropped, %lld written back, %lld dropped behind\n",
+			drop_cnt, writeback_cnt, drop_behind_cnt);
+}
+
+/* [START, END)에 겹치는 페이지가 있으면 false를 돌려 spt_for_each()를 멈춘다. */
+static bool
+page_absent (struct page *page UNUSED, void *aux UNUSED) {
+	return false;
+}
+
+/* [START, END)가 영역이나 페이지(실행 파일, 스택)와 겹치지 않으면 true. */
+static bool
+range_is_free (struct supplemental_page_table *spt, void *start, void *end) {
+	struct list_elem *e;
+
+	for (e = list_begin (&spt->vmas); e != list_end (&spt->vmas); e = list_next (e)) {
+		struct vma *v = list_entry (e, struct vma, elem);
+		if (start < v->end && v->start < end)
+			return false;
+	}
+	return spt_for_each (spt, start, end, page_absent, NULL);
+}
+
+/* [START, END)에 FILE의 OFFSET부터 READ_BYTES 바이트를 담는 영역을 만든다.
+   FILE이 NULL이면 0으로 채워지는 익명 영역이다. FILE은 영역이 가진다.
+   파일 영역은 폴트 한 번에 AROUND개까지 함께 읽는다. */
+static struct vma *
+vma_add (struct supplemental_page_table *spt, void *start, void *end,
+		struct file *file, off_t offset, size_t read_bytes, bool writable,
+		size_t around) {
+	struct vma *vma = malloc (sizeof *vma);
+
+	if (vma == NULL)
+		return NULL;
+	vma->start = start;
+	vma->end = end;
+	vma->file = file;
+	vma->offset = offset;
+	vma->read_bytes = read_bytes;
+	vma->writable = writable;
+	vma->window = around;
+	vma->around = around;
+	vma->drop_behind = false;
+	list_push_back (&spt->vmas, &vma->elem);
+	return vma;
 }
 
 /* Do the mmap */
+/* 영역 하나(struct vma)만 기록하고 페이지는 만들지 않는다.
+   각 페이지는 처음 폴트가 날 때 vma_fault_page()가 만든다.
+   FILE이 NULL이면 익명 매핑이다.
+   WRITABLE에 MAP_POPULATE가 있으면 파일 내용이 있는 페이지를 지금 모두 읽어 매핑한다.
+   MAP_AROUND(N)이 있으면 이 영역은 폴트마다 N개까지 함께 읽고, 없으면 file_fault_around개. */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = addr + ROUND_UP (length, PGSIZE);
+	off_t file_len = file != NULL ? file_length (file) : 0;
+	bool populate = (writable & MAP_POPULATE) != 0;
+	size_t around = (unsigned) writable >> MAP_AROUND_SHIFT;
+	size_t read_bytes;
+	struct vma *vma;
 
-	// 파일과 동일한 inode의 새 파일을 연다. 
-	struct file *mfile = file_reopen(file);
-	
-	void * start_addr = addr;
-	size_t read_bytes = length > file_length(file) ? file_length(file) : length;
-	size_t zero_bytes = PGSIZE - read_bytes % PGSIZE;
-
-	/* 파일을 페이지 단위로 잘라 해당 파일의 정보들을 container 구조체에 저장한다.
-	   FILE-BACKED 타입의 UINIT 페이지를 만들어 lazy_load_segment()를 vm_init으로 넣는다. */
-	while (read_bytes > 0 || zero_bytes > 0) {
-		
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		struct container *container = (struct container*)malloc(sizeof(struct container));
-		container->file = mfile;
-		container->offset = offset;
-		container->page_read_bytes = page_read_bytes;
-
-		if (!vm_alloc_page_with_initializer (VM_FILE, addr, writable, lazy_load_segment, container)) {
-			return NULL;
-    	}
-		
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		addr       += PGSIZE;
-		offset     += page_read_bytes;
-		
+	writable &= ~MAP_POPULATE & (MAP_AROUND (1) - 1);
+	if (around == 0)
+		around = file_fault_around;
+	else if (around > FAULT_AROUND_MAX)
+		around = FAULT_AROUND_MAX;
+	if (length == 0 || end <= addr || !is_user_vaddr (end - 1))
+		return NULL;
+	if (!range_is_free (spt, addr, end))
+		return NULL;
+
+	read_bytes = file_len > offset ? (size_t) (file_len - offset) : 0;
+	if (read_bytes > length)
+		read_bytes = length;
+	// 파일과 동일한 inode의 새 파일을 연다.
+	if (file != NULL && (file = file_reopen (file)) == NULL)
+		return NULL;
+	vma = vma_add (spt, addr, end, file, offset, read_bytes, writable, around);
+	if (vma == NULL) {
+		file_close (file);
+		return NULL;
 	}
-	return start_addr;
+	if (populate)
+		vm_populate (spt, addr, addr + ROUND_UP (read_bytes, PGSIZE));
+	return addr;
+}
+
+/* ADDR부터 시작하는 영역을 찾는다. */
+static struct vma *
+vma_find_start (struct supplemental_page_table *spt, void *addr) {
+	struct vma *vma = vma_find (spt, addr);
+
+	return vma != NULL && vma->start == addr ? vma : NULL;
+}
+
+/* 영역의 페이지 하나를 spt에서 지운다. */
+static bool
+page_unmap (struct page *page, void *spt) {
+	spt_remove_page (spt, page);
+	return true;
+}
+
+/* VMA를 없앤다. 폴트로 만들어졌던 페이지만 지우면 되므로 비용은 영역 크기가 아니라
+   실제로 쓴 페이지 수에 비례한다. */
+static void
+vma_remove (struct supplemental_page_table *spt, struct vma *vma) {
+	/* 변경 사항을 파일 순서대로 묶어서 쓰고 spt에서 지운다.
+	   (프레임 해제는 file_backed_destroy()에서 한다) */
+	vm_flush_range (spt, vma->start, vma->end);
+	spt_for_each (spt, vma->start, vma->end, page_unmap, spt);
+	list_remove (&vma->elem);
+	file_close (vma->file);
+	free (vma);
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
-	
-	/* ADDR부터 연속된 모든 페이지를 변경 사항을 업데이트하고 매핑 정보를 지운다.
-	   가상 페이지가 free되는 것이 아니다. present bit을 0으로 만들어 주는 것이다. */
-	
-	while(true){
-		struct page* page = spt_find_page(&thread_current()->spt, addr);
-
-		if (page == NULL)
-			break;;
-		
-		struct container* container = (struct container *)page->uninit.aux;
-
-		/* 수정된 페이지(더티 비트 1)는 파일에 업데이트 해 놓는다. 
-		   그리고 더티 비트를 0으로 만들어둔다. */
-		if (pml4_is_dirty(thread_current()->pml4, page->va)){
-			file_write_at(container->file, addr, 
-				container->page_read_bytes, container->offset);
-			pml4_set_dirty(thread_current()->pml4, page->va, 0);
+	struct supplemental_page_table *spt = &thread_current()->spt;
+	struct vma *vma = vma_find_start (spt, addr);
+
+	if (vma != NULL)
+		vma_remove (spt, vma);
+}
+
+/* Do the brk */
+/* 프로그램 break를 ADDR로 옮긴다. 힙은 [heap_start, brk)를 덮는 익명 영역 하나이다.
+   늘릴 때는 영역 끝만 늘리고 페이지는 폴트 때 만들어진다. 줄이면 넘어간 페이지를 지운다.
+   다른 영역과 겹치거나 스택이 자랄 자리(1MB)를 넘으면 옮기지 않고 false. */
+bool
+do_brk (void *addr) {
+	struct thread *t = thread_current ();
+	struct supplemental_page_table *spt = &t->spt;
+	struct vma *heap = vma_find_start (spt, t->heap_start);
+	void *old_end = heap != NULL ? heap->end : t->heap_start;
+	void *new_end = (void *) ROUND_UP ((uintptr_t) addr, PGSIZE);
+
+	if (addr < t->heap_start || new_end > (void *) (USER_STACK - 0x100000))
+		return false;
+
+	if (new_end > old_end) {
+		if (!range_is_free (spt, old_end, new_end))
+			return false;
+		if (heap == NULL
+				&& (heap = vma_add (spt, t->heap_start, new_end, NULL, 0, 0, true, 1)) == NULL)
+			return false;
+		heap->end = new_end;
+	}
+	else if (new_end < old_end) {
+		if (new_end == heap->start)
+			vma_remove (spt, heap);
+		else {
+			spt_for_each (spt, new_end, old_end, page_unmap, spt);
+			heap->end = new_end;
 		}
+	}
+	t->brk = addr;
+	return true;
+}
+
+/* Do the msync */
+/* [ADDR, ADDR + LENGTH)의 더티 페이지를 파일에 쓴다.
+   범위에 mmap 영역이 아닌 곳이 있으면 아무것도 하지 않고 false. */
+bool
+do_msync (void *addr, size_t length) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = addr + ROUND_UP (length, PGSIZE);
+
+	for (void *va = addr; va < end; ) {
+		struct vma *vma = vma_find (spt, va);
+
+		if (vma == NULL)
+			return false;
+		va = vma->end;
+	}
+	vm_flush_range (spt, addr, end);
+	return true;
+}
+
+/* VA가 들어 있는 영역. 없으면 NULL. */
+struct vma *
+vma_find (struct supplemental_page_table *spt, void *va) {
+	struct list_elem *e;
+
+	for (e = list_begin (&spt->vmas); e != list_end (&spt->vmas); e = list_next (e)) {
+		struct vma *vma = list_entry (e, struct vma, elem);
+		if (vma->start <= va && va < vma->end)
+			return vma;
+	}
+	return NULL;
+}
+
+/* VA가 mmap 영역 안이면 그 페이지를 만들어 spt에 넣고 돌려준다.
+   페이지마다 필요한 정보(container)는 이때 영역에서 계산해 만든다. */
+struct page *
+vma_fault_page (struct supplemental_page_table *spt, void *va) {
+	struct vma *vma = vma_find (spt, va);
+	void *upage = pg_round_down (va);
+	struct container *container;
+	size_t ofs;
 
-		/* present bit을 0으로 만든다. */
-		pml4_clear_page(thread_current()->pml4, page->va);
-		addr += PGSIZE; 
+	if (vma == NULL)
+		return NULL;
+	/* 익명 영역(익명 mmap, 힙)의 페이지는 0으로 채워진 익명 페이지이다. */
+	if (vma->file == NULL)
+		return vm_alloc_page (VM_ANON, upage, vma->writable) ? spt_find_page (spt, upage) : NULL;
+	container = malloc (sizeof *container);
+	if (container == NULL)
+		return NULL;
+
+	ofs = upage - vma->start;
+	container->file = vma->file;
+	container->offset = vma->offset + ofs;
+	container->page_read_bytes = vma->read_bytes > ofs ? vma->read_bytes - ofs : 0;
+	if (container->page_read_bytes > PGSIZE)
+		container->page_read_bytes = PGSIZE;
+	container->page_zero_bytes = PGSIZE - container->page_read_bytes;
+	container->window = vma->window;
+	container->around = vma->around;
+	container->shared = false;
+	container->drop_behind = vma->drop_behind;
+
+	if (!vm_alloc_page_with_initializer (VM_FILE, upage, vma->writable,
+				lazy_load_segment, container)) {
+		free (container);
+		return NULL;
+	}
+	return spt_find_page (spt, upage);
+}
+
+/* fork할 때 부모에서 복사해 온 파일 PAGE에 자기 container를 만들어 준다.
+   mmap 페이지는 자식 영역(DST)의 파일을 가리키게 하고,
+   실행 파일 text 페이지는 같은 실행 파일을 그대로 가리킨다. */
+bool
+vma_page_copy (struct supplemental_page_table *dst, struct page *page) {
+	struct vma *vma = vma_find (dst, page->va);
+	struct container *container = malloc (sizeof *container);
+
+	if (container == NULL)
+		return false;
+	*container = *(struct container *) page->uninit.aux;
+	if (vma != NULL)
+		container->file = vma->file;
+	page->uninit.aux = container;
+	return true;
+}
+
+/* fork할 때 SRC의 영역들을 DST에 복사한다. 파일은 영역마다 다시 연다. */
+bool
+vma_copy (struct supplemental_page_table *dst, struct supplemental_page_table *src) {
+	struct list_elem *e;
+
+	for (e = list_begin (&src->vmas); e != list_end (&src->vmas); e = list_next (e)) {
+		struct vma *vma = malloc (sizeof *vma);
+
+		if (vma == NULL)
+			return false;
+		*vma = *list_entry (e, struct vma, elem);
+		if (vma->file != NULL && (vma->file = file_reopen (vma->file)) == NULL) {
+			free (vma);
+			return false;
+		}
+		list_push_back (&dst->vmas, &vma->elem);
+	}
+	return true;
+}
+
+/* 파일 PAGE의 container에 ADVICE(MADV_*)에 맞는 읽기 방식을 기록한다.
+   fork한 자식과 공유하는 쓰기 가능한 세그먼트의 container는 건드리지 않는다. */
+static bool
+page_advise (struct page *page, void *advice_) {
+	int advice = *(int *) advice_;
+	struct container *c = page->uninit.aux;
+
+	if (page_get_type (page) != VM_FILE)
+		return true;
+	if (advice == MADV_SEQUENTIAL)
+		c->around = FAULT_AROUND_MAX;
+	else
+		c->around = advice == MADV_NORMAL ? c->window : 1;
+	c->drop_behind = advice == MADV_SEQUENTIAL && !c->shared;
+	return true;
+}
+
+/* [START, END)에 대한 ADVICE를 그 안의 파일 페이지와, 걸쳐 있는 mmap 영역에 기록한다.
+   영역은 나누지 않으므로 일부만 걸쳐도 앞으로 그 영역에서 만들어질 페이지 전체에 적용된다.
+   SEQUENTIAL은 폴트마다 FAULT_AROUND_MAX개씩 읽고 지나간 페이지를 내보내며,
+   RANDOM은 건드린 페이지만 읽고, NORMAL은 매핑이 처음 정한 개수(window)로 되돌린다. */
+void
+vma_advise (struct supplemental_page_table *spt, void *start, void *end, int advice) {
+	struct list_elem *e;
+
+	for (e = list_begin (&spt->vmas); e != list_end (&spt->vmas); e = list_next (e)) {
+		struct vma *vma = list_entry (e, struct vma, elem);
+
+		if (start < vma->end && vma->start < end) {
+			vma->around = advice == MADV_SEQUENTIAL ? FAULT_AROUND_MAX
+				: advice == MADV_NORMAL ? vma->window : 1;
+			vma->drop_behind = advice == MADV_SEQUENTIAL;
+		}
+	}
+	spt_for_each (spt, start, end, page_advise, &advice);
+}
+
+/* 모든 영역을 없앤다. 페이지는 이미 다 지운 뒤에 부른다. */
+void
+vma_kill (struct supplemental_page_table *spt) {
+	while (!list_empty (&spt->vmas)) {
+		struct vma *vma = list_entry (list_pop_front (&spt->vmas), struct vma, elem);
+		file_close (vma->file);
+		free (vma);
 	}
 }
@@ -10,6 +10,7 @@
 
 #include "vm/vm.h"
 #include "vm/uninit.h"
+#include "threads/malloc.h"
 
 static bool uninit_initialize (struct page *page, void *kva);
 static void uninit_destroy (struct page *page);
@@ -71,4 +72,12 @@ uninit_destroy (struct page *page) {
 	 * TODO: If you don't have anything to do, just return. */
 	// struct lazy_load_info * info = (struct lazy_load_info *)(uninit->aux);
 	// file_close(&info->file);
+
+	/* 읽기만 해서 공유 zero 페이지를 보고 있던 페이지 */
+	vm_zero_unmap (page);
+
+	/* 파일 페이지(mmap, 실행 파일 text)의 container는 페이지마다 따로 가지므로 여기서 해제한다.
+	   (쓰기 가능한 세그먼트의 container는 fork한 자식과 공유하므로 두고) */
+	if (VM_TYPE (uninit->type) == VM_FILE)
+		free (uninit->aux);
 }
@@ -1,16 +1,153 @@
 /* vm.c: Generic interface for virtual memory objects. */
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include "vm/evict.h"
 #include "userprog/process.h"
 #include "userprog/syscall.h"
 #include "filesys/file.h"
 #include "threads/vaddr.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
 
+/* 프레임 테이블. 유저 풀의 i번째 페이지가 frame_table[i]이다.
+   kva -> frame은 (kva - frame_base) / PGSIZE로 바로 구한다. */
+static struct frame *frame_table;
+static size_t frame_cnt;
+static uint8_t *frame_base;
+static struct lock frame_lock;	/* 프레임 테이블, frame->pages, 교체 정책 상태를 보호 */
+static size_t frame_free_cnt;	/* 유저 풀에 남은 빈 프레임 수 */
 
-struct list frame_table;
-struct list_elem *start;
-void printf_hash (struct supplemental_page_table *spt);
+/* 백그라운드 회수(reclaim) 스레드.
+   빈 프레임이 낮은 워터마크 아래로 내려가면 깨어나서 높은 워터마크까지
+   미리 페이지를 내보낸다. 그러면 폴트 대부분이 디스크 쓰기를 기다리지 않는다.
+   워터마크는 -vmlow=N, -vmhigh=N으로 바꿀 수 있고 0이면 프레임 수에 맞춰 정한다. */
+size_t vm_reclaim_low;
+size_t vm_reclaim_high;
+static struct semaphore reclaim_sema;
+static bool reclaim_active;		/* 회수 스레드가 깨어 있는 동안 true */
+static void reclaim_daemon (void *aux);
+
+/* 회수 통계. */
+static long long direct_reclaim_cnt;	/* 폴트를 처리하던 스레드가 직접 내보낸 페이지 수 */
+static long long background_reclaim_cnt;	/* 회수 스레드가 내보낸 페이지 수 */
+static long long reclaim_wakeup_cnt;	/* 회수 스레드를 깨운 횟수 */
+
+/* 실행 파일 text 공유.
+   읽기 전용 ELF 세그먼트의 페이지는 (inode, 오프셋, 읽는 바이트 수)가 같으면 내용도 같다.
+   그런 페이지를 읽어 둔 프레임을 text_frames에 기록해 두고, 같은 프로그램을 실행한
+   다른 프로세스가 폴트를 내면 디스크에서 다시 읽지 않고 그 프레임을 읽기 전용으로 같이 매핑한다.
+   이 페이지들은 VM_FILE이고 더럽혀지지 않으므로 쫓겨날 때 스왑에 쓰지 않고 그냥 버린다.
+   프레임이 풀에 돌아가거나 쫓겨나면 기록에서 뺀다. frame_lock이 보호한다. */
+static struct hash text_frames;
+static long long text_share_cnt;	/* 다른 프로세스가 읽어 둔 프레임을 같이 매핑한 폴트 수 */
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+static void text_forget (struct frame *frame);
+
+/* 공유 zero 페이지.
+   0으로만 채워질 익명 페이지(init이 없는 익명 페이지, 파일에서 읽을 것이 없는 BSS 페이지)를
+   읽기만 하면 프레임을 주지 않고 이 페이지 하나를 읽기 전용으로 매핑한다.
+   처음 쓰려고 할 때 write-protect 폴트(vm_handle_wp)에서 자기 프레임을 받는다.
+   프레임 테이블 밖의 커널 페이지이므로 쫓겨나지 않는다. */
+static void *zero_page;
+static long long zero_map_cnt;		/* zero 페이지를 매핑한 읽기 폴트 수 */
+static long long zero_cow_cnt;		/* zero 페이지에서 자기 프레임으로 옮긴 쓰기 수 */
+
+/* 같은 내용의 익명 페이지 합치기 (KSM).
+   낮은 우선순위의 ksmd 스레드가 KSM_SLEEP tick마다 프레임 표를 vm_ksm_pages칸씩 돌면서
+   익명 페이지의 내용을 해시한다. 지난번 방문 때와 해시가 같은(그 사이 바뀌지 않은)
+   프레임만 ksm_frames에 기록해 두고, 해시가 같은 프레임이 이미 있으면 둘 다 읽기 전용으로
+   바꾼 뒤 내용을 비교한다. 같으면 한쪽 페이지들을 다른 프레임에 옮겨 fork 후처럼
+   COW로 같이 매핑하고 남은 프레임은 풀에 돌려준다. 먼저 쓰는 쪽은 vm_handle_wp()에서
+   자기 복사본을 받는다.
+   CR0.WP가 꺼져 있어서 커널은 읽기 전용 PTE를 무시하고 쓸 수 있으므로
+   시스템 콜 중인 프로세스(in_syscall)의 페이지는 합치지 않는다. frame_lock이 보호한다. */
+#define KSM_SLEEP 10
+size_t vm_ksm_pages;
+static struct hash ksm_frames;
+static size_t ksm_cursor;			/* 다음에 살펴볼 프레임 번호 */
+static long long ksm_scan_cnt;		/* 해시를 계산한 프레임 수 */
+static long long ksm_merge_cnt;		/* 다른 프레임으로 옮겨 합친 페이지 수 */
+static long long ksm_pass_cnt;		/* 프레임 표를 다 돈 횟수 */
+static hash_hash_func ksm_hash;
+static hash_less_func ksm_less;
+static void ksm_forget (struct frame *frame);
+static void ksm_daemon (void *aux);
+
+/* madvise(MADV_WILLNEED)의 백그라운드 미리 읽기.
+   시스템 콜은 메모리에 없는 페이지마다 빈 프레임을 고정해서 붙이고 prefetch_queue에 넣은 뒤
+   바로 돌아간다. prefetchd 스레드가 하나씩 꺼내 디스크에서 읽고 매핑한 다음 고정을 푼다.
+   읽는 동안은 page->prefetch가 true이고, 그 페이지에 폴트를 내거나 페이지를 없애려는 쪽은
+   vm_page_wait()에서 기다린다. 큐와 prefetch 표시는 frame_lock이 보호한다.
+   frame_lock을 놓고 프레임을 디스크에 쓰는 동안(frame->io)에도 같은 곳에서 기다린다. */
+struct prefetch_req {
+	struct list_elem elem;
+	struct page *page;
+	struct frame *frame;	/* PAGE에 붙여 둔 (고정된) 프레임 */
+};
+static struct list prefetch_queue;
+static struct semaphore prefetch_sema;	/* 큐에 든 요청 수 */
+static struct condition page_io_done;	/* 미리 읽기나 프레임 쓰기 하나가 끝날 때마다 알린다 */
+static long long prefetch_queue_cnt;	/* 미리 읽으려고 큐에 넣은 페이지 수 */
+static long long prefetch_read_cnt;		/* 미리 읽어 매핑한 페이지 수 */
+static long long dontneed_cnt;			/* DONTNEED로 프레임이나 스왑 슬롯을 돌려준 페이지 수 */
+static void prefetch_daemon (void *aux);
+static bool page_io_wait (struct page *page);
+
+/* 더티 mmap 페이지의 백그라운드 writeback.
+   flushd 스레드가 vm_flush_interval tick마다 프레임 표를 훑어서 더티인 mmap 페이지를
+   FLUSH_BATCH개씩 모으고, (inode, 오프셋) 순으로 정렬해서 파일에서 이어지는 페이지는
+   한 번의 file_write_at()으로 쓴다. 쓰기 전에 더티 비트를 지우므로 그 뒤에 다시 쓴 페이지는
+   다음 번에 또 쓴다. 그래서 munmap이나 exit 때는 아직 더티로 남은 페이지만 쓰면 된다.
+   쓰는 동안에는 frame_lock을 놓고, 대신 쫓아낼 때처럼 프레임을 고정하고 frame->io를
+   세워서 페이지와 파일이 없어지지 않게 한다. */
+#define FLUSH_BATCH 16
+size_t vm_flush_interval = TIMER_FREQ;
+static uint8_t *flush_buf;			/* FLUSH_BATCH 페이지짜리 버퍼 (flush_lock이 보호) */
+static struct lock flush_lock;		/* flush_buf를 쓰는 동안 잡는다. frame_lock보다 먼저 잡는다. */
+static long long flush_page_cnt;	/* 파일에 다시 쓴 페이지 수 */
+static long long flush_write_cnt;	/* 그러느라 부른 file_write_at() 수 */
+static void flush_daemon (void *aux);
+
+/* 쫓아내기 전에 미리 써 두기 (WSClock).
+   교체 정책의 바늘이 작업 집합 밖인데 더티인 프레임을 지나가면 frame_start_clean()으로
+   clean_queue에 넣는다. cleand 스레드가 파일 페이지는 flush_frames()로 파일에,
+   익명 페이지는 anon_swap_clean()으로 스왑 슬롯에 써 두고 더티 표시를 지운다.
+   다음 바퀴에 그대로 깨끗하면 디스크에 쓰지 않고 바로 쫓아낼 수 있다.
+   큐는 frame_lock이 보호하고, 꺼낼 때 프레임 상태를 다시 확인한다. */
+#define CLEAN_QUEUE 64
+static struct frame *clean_queue[CLEAN_QUEUE];	/* 원형 큐 */
+static size_t clean_head, clean_queue_len;
+static struct semaphore clean_sema;	/* 큐에 넣을 때마다 올린다 */
+static long long clean_start_cnt;	/* 큐에 넣은 프레임 수 */
+static void clean_daemon (void *aux);
+
+/* 매핑하면서 바로 읽어 오기 (mmap의 MAP_POPULATE, -populate일 때 실행 파일 세그먼트).
+   파일에서 이어지는 페이지를 POPULATE_BATCH개씩 한 번의 file_read_at()으로 읽고
+   pml4_set_pages()로 PTE를 한꺼번에 채워서 페이지마다 폴트가 나지 않게 한다. */
+#define POPULATE_BATCH 32
+bool vm_populate_exec;
+static long long populate_page_cnt;	/* 미리 읽어 매핑한 페이지 수 */
+static long long populate_read_cnt;	/* 그러느라 부른 file_read_at() 수 */
+
+/* 2 MB 페이지.
+   익명 영역(익명 mmap, 힙)에 폴트가 났을 때 그 주소가 든 2 MB 구간 전체가 영역 안이고
+   아직 페이지가 하나도 없으면, 유저 풀에서 물리 주소가 2 MB 정렬된 연속 프레임 512개를 받아
+   PDE 하나(PTE_PS)로 매핑한다. 폴트 한 번에 512페이지가 채워지고 TLB 항목도 하나만 쓴다.
+   PDE에는 accessed/dirty 비트가 하나뿐이라 블록의 프레임은 쫓아내지 않는다.
+   일부를 munmap하거나, fork로 COW가 되거나, 쫓아낼 프레임이 없을 때 블록을 보통 프레임
+   512개로 되돌린다(huge_demote). PDE는 그 페이지의 PTE를 바꿀 때 mmu가 알아서 나눈다.
+   파일 영역은 쓰기를 페이지 단위로 파일에 되돌려야 하므로 하지 않는다.
+   huge_frames에는 블록의 첫 프레임이 만든 순서대로 들어 있다. frame_lock이 보호한다. */
+bool vm_huge_pages = true;
+static struct list huge_frames;
+static size_t huge_live_cnt;		/* 지금 2 MB 페이지로 매핑된 블록 수 */
+static long long huge_alloc_cnt;	/* 2 MB 페이지로 채운 폴트 수 */
+static long long huge_split_cnt;	/* 보통 프레임으로 되돌린 블록 수 */
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -24,10 +161,138 @@ vm_init (void) {
 	register_inspect_intr (); 
 	/* DO NOT MODIFY UPPER LINES. */
 	/* TODO: Your code goes here. */
-	list_init(&frame_table);
-	start = list_begin(&frame_table);
+	frame_base = palloc_user_pool (&frame_cnt);
+	frame_table = calloc (frame_cnt, sizeof *frame_table);
+	if (frame_table == NULL)
+		PANIC ("frame table allocation failed");
+	for (size_t i = 0; i < frame_cnt; i++) {
+		frame_table[i].kva = frame_base + i * PGSIZE;
+		frame_table[i].swap_slot = -1;
+		list_init (&frame_table[i].pages);
+	}
+	frame_free_cnt = frame_cnt;
+	hash_init (&text_frames, text_hash, text_less, NULL);
+	hash_init (&ksm_frames, ksm_hash, ksm_less, NULL);
+	zero_page = palloc_get_page (PAL_ZERO);
+	if (zero_page == NULL)
+		PANIC ("zero page allocation failed");
+	lock_init (&frame_lock);
+	evict_init (frame_table, frame_cnt);
+
+	if (vm_reclaim_low == 0)
+		vm_reclaim_low = frame_cnt / 64 > 2 ? frame_cnt / 64 : 2;
+	if (vm_reclaim_high <= vm_reclaim_low)
+		vm_reclaim_high = vm_reclaim_low * 2;
+	sema_init (&reclaim_sema, 0);
+	thread_create ("reclaimd", PRI_DEFAULT, reclaim_daemon, NULL);
+	if (vm_ksm_pages > 0)
+		thread_create ("ksmd", PRI_MIN, ksm_daemon, NULL);
+
+	list_init (&prefetch_queue);
+	sema_init (&prefetch_sema, 0);
+	cond_init (&page_io_done);
+	thread_create ("prefetchd", PRI_DEFAULT, prefetch_daemon, NULL);
+
+	list_init (&huge_frames);
+
+	lock_init (&flush_lock);
+	flush_buf = palloc_get_multiple (0, FLUSH_BATCH);
+	if (flush_buf == NULL)
+		PANIC ("flush buffer allocation failed");
+	if (vm_flush_interval > 0)
+		thread_create ("flushd", PRI_DEFAULT, flush_daemon, NULL);
+
+	sema_init (&clean_sema, 0);
+	thread_create ("cleand", PRI_DEFAULT, clean_daemon, NULL);
+}
+
+/* KVA가 들어 있는 유저 풀 프레임의 테이블 항목을 돌려준다. */
+struct frame *
+vm_frame_lookup (void *kva) {
+	size_t idx = ((uint8_t *) pg_round_down (kva) - frame_base) / PGSIZE;
+
+	ASSERT ((uint8_t *) kva >= frame_base && idx < frame_cnt);
+	return &frame_table[idx];
+}
+
+/* 채우기/복사가 끝난 프레임을 다시 교체 대상으로 돌려놓는다. */
+static void
+vm_frame_unpin (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	ASSERT (frame->pin_cnt > 0);
+	frame->pin_cnt--;
+	lock_release (&frame_lock);
+}
+
+/* 새로 내줄 FRAME의 상태를 초기화한다. frame_lock을 잡고 불러야 한다.
+   호출한 쪽이 페이지를 연결하고 내용을 채울 때까지 쫓겨나지 않게 고정해 두므로
+   다 채운 뒤 vm_frame_unpin()으로 풀어 줘야 한다. */
+static void
+frame_reset (struct frame *frame) {
+	frame->page = NULL;
+	frame->owner = NULL;
+	frame->pin_cnt = 1;
+	frame->accessed = false;
+	frame->dirty = false;
+	frame->last_used = timer_ticks ();
+	frame->ksm_sum = 0;
+}
+
+/* 빈 FRAME을 유저 풀에 돌려준다. frame_lock을 잡고 불러야 한다. */
+static void
+frame_free (struct frame *frame) {
+	text_forget (frame);
+	ksm_forget (frame);
+	anon_swap_forget (frame);
+	frame->page = NULL;
+	frame->owner = NULL;
+	palloc_free_page (frame->kva);
+	frame_free_cnt++;
+}
+
+/* FRAME이 2 MB 페이지 블록에 들어 있으면 블록을 보통 프레임 512개로 되돌려
+   교체 정책에 넣는다. frame_lock을 잡고 불러야 한다. */
+static void
+huge_demote (struct frame *frame) {
+	struct frame *head;
+
+	if (!frame->huge)
+		return;
+	head = vm_frame_lookup (hpg_round_down (frame->kva));
+	list_remove (&head->huge_elem);
+	for (size_t i = 0; i < HPG_CNT; i++) {
+		head[i].huge = false;
+		if (head[i].page != NULL)
+			evict_insert (&head[i]);
+	}
+	huge_live_cnt--;
+	huge_split_cnt++;
+}
+
+/* PAGE를 FRAME의 공유 목록에서 뺀다. frame_lock을 잡고 불러야 한다.
+   남은 페이지가 있으면 대표 페이지를 바꾸고, 없으면 프레임을 풀에 돌려준다. */
+static void
+frame_unlink (struct frame *frame, struct page *page) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	huge_demote (frame);
+	list_remove (&page->share_elem);
+	page->frame = NULL;
+
+	if (!list_empty (&frame->pages)) {
+		if (frame->page == page) {
+			frame->page = list_entry (list_front (&frame->pages), struct page, share_elem);
+			frame->owner = frame->page->owner;
+		}
+		return;
+	}
+
+	ASSERT (frame->pin_cnt == 0);
+	evict_remove (frame);
+	frame_free (frame);
 }
 
+
 bool
 install_page (void *upage, void *kpage, bool writable) {
 	struct thread *t = thread_current ();
@@ -55,8 +320,8 @@ page_get_type (struct page *page) {
 /* Helpers */
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool vm_claim_shared (struct page *page);
 static struct frame *vm_evict_frame (void);
-void spt_destructor(struct hash_elem *e, void *aux);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -81,6 +346,8 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		
 		//함수 포인터를 사용하여 TYPE에 맞는 페이지 초기화 함수를 사용
 		struct page *new_page = (struct page *)malloc (sizeof(struct page));
+		if (new_page == NULL)
+			return false;
 		typedef bool (*initializeFunc)(struct page*, enum vm_type, void *);
 		initializeFunc initializer = NULL;
 
@@ -103,12 +370,18 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		uninit_new(new_page, upage, init, type, aux, initializer);
 		
 		new_page->writable = writable;
+		new_page->owner = thread_current ();
+		new_page->ghost = 0;
 		// new_page->vm_type = type;
 		// new_page->page_cnt = -1;	// file-mapped page가 아니므로 -1
 		
 		/* TODO: 페이지를 spt에 삽입합니다. */ 
 		// printf("&&&&&&&&&&&&&%p\n", new_page->va);
-		return spt_insert_page(spt, new_page);
+		if (!spt_insert_page(spt, new_page)) {
+			free (new_page);
+			return false;
+		}
+		return true;
 
 	}
 err:
@@ -116,23 +389,56 @@ err:
 	return false;
 }
 
+/* SPT radix tree. VPN을 9비트씩 4단계로 나눈다 (유저 주소의 VPN은 36비트 안에 든다). */
+#define SPT_BITS 9
+#define SPT_FANOUT (1 << SPT_BITS)
+#define SPT_LEVELS 4
+
+/* VPN이 들어갈 잎 노드의 칸을 돌려준다.
+   CREATE이면 없는 노드를 만들고, 아니면(또는 만들 수 없으면) NULL. */
+static struct page **
+spt_slot (struct supplemental_page_table *spt, uint64_t vpn, bool create) {
+	void **node;
+
+	if (spt->hint != NULL && spt->hint_key == vpn >> SPT_BITS)
+		return (struct page **) &spt->hint[vpn & (SPT_FANOUT - 1)];
+
+	if (spt->root == NULL
+			&& (!create || (spt->root = palloc_get_page (PAL_ZERO)) == NULL))
+		return NULL;
+	node = spt->root;
+	for (int level = SPT_LEVELS - 1; level > 0; level--) {
+		void **child = &node[(vpn >> (SPT_BITS * level)) & (SPT_FANOUT - 1)];
+
+		if (*child == NULL && (!create || (*child = palloc_get_page (PAL_ZERO)) == NULL))
+			return NULL;
+		node = *child;
+	}
+	spt->hint = node;
+	spt->hint_key = vpn >> SPT_BITS;
+	return (struct page **) &node[vpn & (SPT_FANOUT - 1)];
+}
+
 /* Find VA from spt and return page. On error, return NULL. */
-/* spt에서 VA를 찾아 페이지로 리턴. 오류가 발생하면 NULL을 반환합니다. */
+/* spt에서 VA를 찾아 페이지로 리턴. 오류가 발생하면 NULL을 반환합니다.
+   아무것도 할당하지 않으므로 바이트마다, 폴트마다 불러도 싸다. */
 struct page *
 spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = (struct page *)malloc (sizeof(struct page));
-  	struct hash_elem *e;
+	struct page **slot;
 
-	/* 해당 va가 속해 있는 페이지 시작 주소를 가지는 page 만든다.*/
-  	page->va = pg_round_down(va);
-
-	//인자로 들어온 spt에서 인자로 받은 va와 같은 page를 찾아 elem으로 반환 
-  	e = hash_find(&spt->hashs, &page->hash_elem);
+	if (!is_user_vaddr (va))
+		return NULL;
+	slot = spt_slot (spt, pg_no (va), false);
+	return slot != NULL ? *slot : NULL;
+}
 
-	free(page);
+/* VA의 페이지를 찾는다. 아직 페이지가 없어도 mmap 영역 안이면
+   그 자리에서 페이지를 만들어 돌려준다. 폴트와 시스템 콜 인자 확인에 쓴다. */
+struct page *
+spt_lookup_page (struct supplemental_page_table *spt, void *va) {
+	struct page *page = spt_find_page (spt, va);
 
-	// e가 NULL이 아니면 page 구조체로 반환 
-	return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+	return page != NULL ? page : vma_fault_page (spt, va);
 }
 
 /* Insert PAGE into spt with validation. */
@@ -140,65 +446,199 @@ spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
 bool
 spt_insert_page (struct supplemental_page_table *spt UNUSED,
 		struct page *page UNUSED) {
-	
-    if(hash_insert(&spt->hashs, &page->hash_elem) == NULL){
-        return true;
-	}
-    return false;
+	struct page **slot;
+
+	if (!is_user_vaddr (page->va))
+		return false;
+	slot = spt_slot (spt, pg_no (page->va), true);
+	if (slot == NULL || *slot != NULL)
+		return false;
+	*slot = page;
+	spt->page_cnt++;
+	return true;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	struct page **slot = spt_slot (spt, pg_no (page->va), false);
+
+	vm_page_wait (page);
+	if (slot != NULL && *slot == page) {
+		*slot = NULL;
+		spt->page_cnt--;
+	}
 	vm_dealloc_page (page);
+}
+
+/* LEVEL 단계의 NODE(첫 VPN이 BASE) 아래에서 VPN이 [LO, HI)인 페이지마다
+   차례로(주소 순) FUNC를 부른다. 비어 있는 가지는 통째로 건너뛴다.
+   FUNC가 false를 돌려주면 멈추고 false. FUNC 안에서 그 페이지를 빼도 된다. */
+static bool
+spt_walk (void **node, int level, uint64_t base, uint64_t lo, uint64_t hi,
+		bool (*func) (struct page *, void *), void *aux) {
+	uint64_t span = (uint64_t) 1 << (SPT_BITS * level);
+
+	for (int i = 0; i < SPT_FANOUT; i++) {
+		uint64_t first = base + i * span;
+
+		if (first >= hi)
+			break;
+		if (node[i] == NULL || first + span <= lo)
+			continue;
+		if (level == 0 ? !func (node[i], aux)
+				: !spt_walk (node[i], level - 1, first, lo, hi, func, aux))
+			return false;
+	}
 	return true;
 }
 
+/* [START, END) 안에 있는 SPT의 페이지마다 주소 순으로 FUNC를 부른다.
+   FUNC가 false를 돌려주면 멈추고 false. */
+bool
+spt_for_each (struct supplemental_page_table *spt, void *start, void *end,
+		bool (*func) (struct page *, void *), void *aux) {
+	if (spt->root == NULL)
+		return true;
+	return spt_walk (spt->root, SPT_LEVELS - 1, 0,
+			pg_no (start), DIV_ROUND_UP ((uint64_t) end, PGSIZE), func, aux);
+}
+
+/* LEVEL 단계의 NODE 아래 있는 페이지를 모두 없애고 노드도 해제한다. */
+static void
+spt_destroy (void **node, int level) {
+	for (int i = 0; i < SPT_FANOUT; i++) {
+		if (node[i] == NULL)
+			continue;
+		if (level == 0) {
+			vm_page_wait (node[i]);
+			vm_dealloc_page (node[i]);
+		}
+		else
+			spt_destroy (node[i], level - 1);
+	}
+	palloc_free_page (node);
+}
+
 /* Get the struct frame, that will be evicted. */
 /* 제거될 구조체 프레임을 가져옵니다. */
-static struct frame *
-vm_get_victim(void)
-{
-	struct frame *victim = NULL;
-	/* FIFO eviction policy */
-	struct thread *curr = thread_current();
-	struct list_elem *e = start;
+/* FRAME이 마지막 확인 이후 접근되었으면 true를 돌려주고 접근 기록을 지운다.
+   accessed 비트는 프레임을 매핑한 각 주인의 pml4에 있으므로
+   공유하는 페이지마다 자기 주인의 페이지 테이블을 확인한다. */
+bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = frame->accessed;
+	struct list_elem *e;
 
-	
-	for (start = e; start != list_end(&frame_table); start = list_next(start))
-	{
-		victim = list_entry(start, struct frame, frame_elem);
-		if (pml4_is_accessed(curr->pml4, victim->page->va))
-			pml4_set_accessed(curr->pml4, victim->page->va, 0);
-		else
-			return victim;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, share_elem);
+		uint64_t *pml4 = p->owner->pml4;
+
+		if (pml4 != NULL && pml4_is_accessed (pml4, p->va)) {
+			pml4_set_accessed (pml4, p->va, false);
+			accessed = true;
+		}
 	}
 
-	for (start = list_begin(&frame_table); start != e; start = list_next(start))
-	{
-		victim = list_entry(start, struct frame, frame_elem);
-		if (pml4_is_accessed(curr->pml4, victim->page->va))
-			pml4_set_accessed(curr->pml4, victim->page->va, 0);
-		else
-			return victim; 
-	} 
-	return victim;
+	frame->accessed = false;
+	if (accessed)
+		frame->last_used = timer_ticks ();
+	return accessed;
+}
+
+/* FRAME을 쫓아내려면 디스크에 써야 하는지 알려준다.
+   익명 페이지는 미리 써 둔 스왑 슬롯(frame->swap_slot)이 없으면 항상 써야 한다. */
+bool
+frame_is_dirty (struct frame *frame) {
+	enum vm_type type = page_get_type (frame->page);
+	struct list_elem *e;
+
+	if (frame->dirty)
+		return true;
+	if (type != VM_FILE && !(type == VM_ANON && frame->swap_slot >= 0))
+		return true;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, share_elem);
+
+		if (p->owner->pml4 != NULL && pml4_is_dirty (p->owner->pml4, p->va))
+			return true;
+	}
+	return false;
+}
+
+/* Get the struct frame, that will be evicted. */
+/* 제거될 구조체 프레임을 가져옵니다. 어떤 프레임을 고를지는 교체 정책(evict.c)이 정한다. */
+static struct frame *
+vm_get_victim(void)
+{
+	return evict_get_victim ();
 }
 
 /* Evict one page and return the corresponding frame.
  * Return NULL on error.*/
 /* 한 페이지를 제거하고 해당 프레임을 반환합니다.
   * 오류 시 NULL을 반환합니다.*/
+/* frame_lock을 잡고 불러야 한다. 쫓아낼 프레임이 없거나
+   스왑 공간이 모자라면 NULL을 돌려준다.
+   희생자를 디스크에 쓰는 동안은 frame_lock을 놓으므로 그 사이의 폴트와 할당은
+   이 쓰기를 기다리지 않는다. 희생자는 고정하고 정책의 큐와 공유 표에서 빼 두어
+   다른 곳에서 고르거나 같이 쓰지 못하게 하고, 그 페이지를 없애거나 복사하려는 쪽은
+   frame->io가 풀릴 때까지 기다린다. */
 static struct frame *
 vm_evict_frame (void) {
 	struct frame *victim UNUSED = vm_get_victim();
+	bool success;
 	/* TODO: swap out the victim and return the evicted frame. */
-	if (victim != NULL){
-		swap_out(victim->page);
+	/* 쫓아낼 프레임이 없으면 가장 오래된 2 MB 페이지를 나눠서 다시 고른다. */
+	if (victim == NULL && !list_empty (&huge_frames)) {
+		huge_demote (list_entry (list_front (&huge_frames), struct frame, huge_elem));
+		victim = vm_get_victim ();
 	}
+	if (victim == NULL)
+		return NULL;
 
+	victim->pin_cnt++;
+	victim->io = true;
+	text_forget (victim);
+	ksm_forget (victim);
+	lock_release (&frame_lock);
+	success = swap_out (victim->page);
+	lock_acquire (&frame_lock);
+	victim->pin_cnt--;
+	victim->io = false;
+	cond_broadcast (&page_io_done, &frame_lock);
+
+	if (!success) {
+		evict_cancel (victim);	/* 내보내지 못했으니 정책의 큐에 되돌려 놓는다. */
+		return NULL;
+	}
 	return victim; 
 }
 
+/* 빈 프레임이 높은 워터마크에 닿을 때까지 페이지를 내보낸다. */
+static void
+reclaim_daemon (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&reclaim_sema);
+
+		lock_acquire (&frame_lock);
+		while (frame_free_cnt < vm_reclaim_high) {
+			struct frame *frame = vm_evict_frame ();
+
+			if (frame == NULL)
+				break;
+			frame_free (frame);
+			background_reclaim_cnt++;
+
+			/* 프레임을 기다리는 스레드가 있으면 한 페이지마다 양보한다. */
+			lock_release (&frame_lock);
+			thread_yield ();
+			lock_acquire (&frame_lock);
+		}
+		reclaim_active = false;
+		lock_release (&frame_lock);
+	}
+}
+
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
@@ -209,31 +649,310 @@ vm_evict_frame (void) {
 struct frame *
 vm_get_frame(void)
 {
-	// struct frame *frame = NULL;
+	struct frame *frame = NULL;
 	/* TODO: Fill this function. */
-	struct frame *frame = (struct frame *)malloc(sizeof(struct frame));
+	void *kva;
 
-	frame->kva = palloc_get_page(PAL_USER); /* USER POOL에서 커널 가상 주소 공간으로 1page 할당 */
+	/* 빈 프레임이 있으면 frame_lock은 세는 동안만 잡는다.
+	   회수 중인 프레임을 디스크에 쓰는 동안에는 frame_lock이 놓여 있으므로 기다리지 않는다. */
+	kva = palloc_get_page(PAL_USER); /* USER POOL에서 커널 가상 주소 공간으로 1page 할당 */
+	lock_acquire (&frame_lock);
 
 	/* if 프레임이 꽉 차서 할당받을 수 없다면 페이지 교체 실시
-	   else 성공했다면 frame 구조체 커널 주소 멤버에 위에서 할당받은 메모리 커널 주소 넣기 */
-	if (frame->kva == NULL)
-	{
+	   else 성공했다면 할당받은 주소에 해당하는 프레임 테이블 항목을 쓴다. */
+	if (kva == NULL) {
 		frame = vm_evict_frame();
-		frame->page = NULL;
-		return frame;
+		if (frame == NULL)
+			PANIC ("out of memory and swap space");
+		direct_reclaim_cnt++;
+	}
+	else {
+		frame = vm_frame_lookup (kva);
+		frame_free_cnt--;
 	}
 
-	/* 새 프레임을 프레임 테이블에 넣어 관리 */
-	list_push_back (&frame_table, &frame->frame_elem);  
-  
-	frame->page = NULL;
+	/* 빈 프레임이 얼마 남지 않았으면 회수 스레드를 깨운다. */
+	if (frame_free_cnt < vm_reclaim_low && !reclaim_active) {
+		reclaim_active = true;
+		reclaim_wakeup_cnt++;
+		sema_up (&reclaim_sema);
+	}
+
+	frame_reset (frame);
+	lock_release (&frame_lock);
 
 	ASSERT(frame != NULL);
-	ASSERT(frame->page == NULL);
+	ASSERT(list_empty (&frame->pages));
+	return frame;
+}
+
+/* 다른 페이지를 쫓아내지 않고 줄 수 있는 빈 프레임이 넉넉할 때만
+   고정된 프레임을 돌려준다. 없으면 NULL.
+   미리 읽기처럼 당장 꼭 필요하지는 않은 할당에 쓴다. */
+struct frame *
+vm_get_free_frame (void) {
+	struct frame *frame = NULL;
+	void *kva;
+
+	lock_acquire (&frame_lock);
+	if (frame_free_cnt > vm_reclaim_low
+			&& (kva = palloc_get_page (PAL_USER)) != NULL) {
+		frame = vm_frame_lookup (kva);
+		frame_free_cnt--;
+		frame_reset (frame);
+	}
+	lock_release (&frame_lock);
 	return frame;
 }
 
+/* vm_get_free_frame()으로 받았지만 쓰지 않게 된 FRAME을 돌려준다. */
+void
+vm_put_free_frame (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	frame->pin_cnt = 0;
+	frame_free (frame);
+	lock_release (&frame_lock);
+}
+
+/* 내용을 이미 채운 FRAME(vm_get_free_frame()으로 받은 것)을 PAGE에 연결하고
+   매핑한 뒤 고정을 푼다. 매핑하지 못하면 프레임을 돌려주고 false. */
+bool
+vm_install_frame (struct page *page, struct frame *frame) {
+	lock_acquire (&frame_lock);
+	frame->page = page;
+	frame->owner = page->owner;
+	page->frame = frame;
+	list_push_back (&frame->pages, &page->share_elem);
+	evict_insert (frame);
+	frame->pin_cnt--;
+	if (!pml4_set_page (page->owner->pml4, page->va, frame->kva, page->writable)) {
+		frame_unlink (frame, page);
+		lock_release (&frame_lock);
+		return false;
+	}
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* PAGE를 미리 읽어 채울 수 있으면 그 container. 아니면 NULL.
+   아직 읽지 않은 세그먼트나 mmap 페이지, 쫓겨난 파일 페이지 중 파일에서 읽을 내용이 있는 것이다.
+   0으로만 채워질 페이지는 폴트 때 zero 페이지로 충분하므로 건너뛴다. */
+static struct container *
+populate_candidate (struct page *page) {
+	struct container *c;
+
+	if (page == NULL || page->frame != NULL || page->prefetch
+			|| pml4_get_page (page->owner->pml4, page->va) != NULL)
+		return NULL;
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		if (page->uninit.init != lazy_load_segment)
+			return NULL;
+	}
+	else if (VM_TYPE (page->operations->type) != VM_FILE)
+		return NULL;
+
+	c = page->uninit.aux;
+	return c->page_read_bytes > 0 ? c : NULL;
+}
+
+/* 내용을 채운 프레임 KVAS[i]를 PAGES[i]에 연결하고 PTE를 한꺼번에 채운다.
+   PAGES는 주소가 이어지고 쓰기 가능 여부가 같아야 한다.
+   매핑한 앞쪽 페이지 수를 돌려주고, 매핑하지 못한 프레임은 풀에 돌려준다. */
+static size_t
+populate_install (struct page **pages, void **kvas, size_t cnt) {
+	struct page *first = pages[0];
+	size_t mapped;
+
+	lock_acquire (&frame_lock);
+	mapped = pml4_set_pages (first->owner->pml4, first->va, kvas, cnt, first->writable);
+	for (size_t i = 0; i < cnt; i++) {
+		struct page *page = pages[i];
+		struct frame *frame = vm_frame_lookup (kvas[i]);
+
+		if (i >= mapped) {
+			frame->pin_cnt = 0;
+			frame_free (frame);
+			continue;
+		}
+		/* uninit_initialize()처럼 타입에 맞게 바꾸되 내용은 이미 채웠다. */
+		if (VM_TYPE (page->operations->type) == VM_UNINIT)
+			page->uninit.page_initializer (page, page->uninit.type, frame->kva);
+		frame->page = page;
+		frame->owner = page->owner;
+		page->frame = frame;
+		list_push_back (&frame->pages, &page->share_elem);
+		evict_insert (frame);
+		frame->pin_cnt--;
+	}
+	lock_release (&frame_lock);
+
+	/* 처음 읽은 공유 text는 다른 프로세스가 찾을 수 있게 기록한다. */
+	for (size_t i = 0; i < mapped; i++) {
+		struct container *c = pages[i]->uninit.aux;
+
+		if (page_get_type (pages[i]) == VM_FILE && c->shared)
+			vm_text_register (vm_frame_lookup (kvas[i]), c);
+	}
+	return mapped;
+}
+
+/* SPT(현재 스레드의 것)의 [START, END)를 폴트를 기다리지 않고 지금 읽어 매핑한다.
+   다른 프로세스가 이미 읽어 둔 공유 text는 그 프레임을 같이 매핑한다.
+   빈 프레임이 모자라거나 읽지 못하면 거기서 멈추고, 남은 페이지는 폴트 때 읽는다. */
+void
+vm_populate (struct supplemental_page_table *spt, void *start, void *end) {
+	struct page *pages[POPULATE_BATCH];
+	void *kvas[POPULATE_BATCH];
+	uint8_t *buf = palloc_get_multiple (0, POPULATE_BATCH);
+	void *va = start;
+
+	if (buf == NULL)
+		return;
+	while (va < end) {
+		struct page *page = spt_lookup_page (spt, va);
+		struct container *c = populate_candidate (page);
+		struct container *last = c;
+		size_t cnt = 1, got;
+		off_t bytes;
+
+		if (c == NULL || (c->shared && vm_claim_shared (page))) {
+			va += PGSIZE;
+			continue;
+		}
+
+		/* 파일에서 바로 이어지는 뒤쪽 페이지를 모은다. */
+		pages[0] = page;
+		while (cnt < POPULATE_BATCH && va + cnt * PGSIZE < end
+				&& last->page_read_bytes == PGSIZE) {
+			struct page *q = spt_lookup_page (spt, va + cnt * PGSIZE);
+			struct container *qc = populate_candidate (q);
+
+			if (qc == NULL || qc->file != c->file || q->writable != page->writable
+					|| qc->offset != c->offset + (off_t) (cnt * PGSIZE)
+					|| (qc->shared && vm_text_cached (qc)))
+				break;
+			pages[cnt++] = q;
+			last = qc;
+		}
+
+		for (got = 0; got < cnt; got++) {
+			struct frame *frame = vm_get_free_frame ();
+
+			if (frame == NULL)
+				break;
+			kvas[got] = frame->kva;
+		}
+		if (got < cnt) {
+			cnt = got;
+			last = cnt > 0 ? pages[cnt - 1]->uninit.aux : NULL;
+		}
+		if (cnt == 0)
+			break;
+
+		bytes = (cnt - 1) * PGSIZE + last->page_read_bytes;
+		if (file_read_at (c->file, buf, bytes, c->offset) != bytes) {
+			for (size_t i = 0; i < cnt; i++)
+				vm_put_free_frame (vm_frame_lookup (kvas[i]));
+			break;
+		}
+		populate_read_cnt++;
+		for (size_t i = 0; i < cnt; i++) {
+			size_t read_bytes = ((struct container *) pages[i]->uninit.aux)->page_read_bytes;
+
+			memcpy (kvas[i], buf + i * PGSIZE, read_bytes);
+			memset (kvas[i] + read_bytes, 0, PGSIZE - read_bytes);
+		}
+		got = populate_install (pages, kvas, cnt);
+		populate_page_cnt += got;
+		if (got < cnt)
+			break;
+		va += cnt * PGSIZE;
+	}
+	palloc_free_multiple (buf, POPULATE_BATCH);
+}
+
+static bool
+page_absent (struct page *page UNUSED, void *aux UNUSED) {
+	return false;
+}
+
+/* ADDR이 든 2 MB 구간을 2 MB 페이지 하나로 채운다.
+   익명 영역이 구간 전체를 덮고, 구간에 페이지가 하나도 없고,
+   빈 프레임을 넉넉히 남기고 정렬된 연속 프레임을 받을 수 있을 때만 한다.
+   그러지 못하면 false이고 보통처럼 4 kB 페이지 하나를 처리한다. */
+static bool
+vm_huge_fault (struct supplemental_page_table *spt, void *addr) {
+	struct thread *t = thread_current ();
+	uint8_t *start = hpg_round_down (addr);
+	uint8_t *end = start + HPGSIZE;
+	struct vma *vma = vma_find (spt, addr);
+	struct frame *head;
+	uint8_t *kva = NULL;
+	size_t cnt;
+
+	if (!vm_huge_pages || vma == NULL || vma->file != NULL
+			|| start < (uint8_t *) vma->start || end > (uint8_t *) vma->end
+			|| !spt_for_each (spt, start, end, page_absent, NULL))
+		return false;
+
+	lock_acquire (&frame_lock);
+	if (frame_free_cnt >= vm_reclaim_low + HPG_CNT)
+		kva = palloc_get_aligned (PAL_USER, HPG_CNT, HPG_CNT);
+	if (kva == NULL) {
+		lock_release (&frame_lock);
+		return false;
+	}
+	frame_free_cnt -= HPG_CNT;
+	head = vm_frame_lookup (kva);
+	for (size_t i = 0; i < HPG_CNT; i++) {
+		frame_reset (&head[i]);
+		head[i].huge = true;
+	}
+	lock_release (&frame_lock);
+
+	/* 페이지를 만들고 익명 페이지로 바꾸면서 프레임을 0으로 채운다. */
+	for (cnt = 0; cnt < HPG_CNT; cnt++) {
+		struct page *page;
+
+		if (!vm_alloc_page (VM_ANON, start + cnt * PGSIZE, vma->writable))
+			goto fail;
+		page = spt_find_page (spt, start + cnt * PGSIZE);
+		page->uninit.page_initializer (page, page->uninit.type, head[cnt].kva);
+	}
+
+	lock_acquire (&frame_lock);
+	if (!pml4_set_huge_page (t->pml4, start, kva, vma->writable)) {
+		lock_release (&frame_lock);
+		goto fail;
+	}
+	for (size_t i = 0; i < HPG_CNT; i++) {
+		struct page *page = spt_find_page (spt, start + i * PGSIZE);
+
+		head[i].page = page;
+		head[i].owner = t;
+		page->frame = &head[i];
+		list_push_back (&head[i].pages, &page->share_elem);
+		head[i].pin_cnt--;
+	}
+	list_push_back (&huge_frames, &head->huge_elem);
+	huge_live_cnt++;
+	huge_alloc_cnt++;
+	lock_release (&frame_lock);
+	return true;
+
+fail:
+	while (cnt-- > 0)
+		spt_remove_page (spt, spt_find_page (spt, start + cnt * PGSIZE));
+	lock_acquire (&frame_lock);
+	for (size_t i = 0; i < HPG_CNT; i++) {
+		head[i].huge = false;
+		head[i].pin_cnt = 0;
+		frame_free (&head[i]);
+	}
+	lock_release (&frame_lock);
+	return false;
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth(void *addr UNUSED) {
@@ -245,10 +964,123 @@ vm_stack_growth(void *addr UNUSED) {
 	}
 }
 
+/* 아직 읽지 않은, 0으로만 채워질 익명 페이지이면 true. */
+static bool
+page_is_zero_fill (struct page *page) {
+	struct uninit_page *uninit = &page->uninit;
+
+	if (VM_TYPE (page->operations->type) != VM_UNINIT || VM_TYPE (uninit->type) != VM_ANON)
+		return false;
+	return uninit->init == NULL
+		|| (uninit->init == lazy_load_segment
+			&& ((struct container *) uninit->aux)->page_read_bytes == 0);
+}
+
+/* PAGE가 지금 공유 zero 페이지에 매핑되어 있으면 true. */
+static bool
+vm_zero_mapped (struct page *page) {
+	uint64_t *pml4 = page->owner->pml4;
+
+	return page->frame == NULL && pml4 != NULL && pml4_get_page (pml4, page->va) == zero_page;
+}
+
+/* 0으로 채울 PAGE를 읽기만 하는 폴트이면 공유 zero 페이지를 읽기 전용으로 매핑한다. */
+static bool
+vm_map_zero (struct page *page) {
+	if (!page_is_zero_fill (page)
+			|| !pml4_set_page (page->owner->pml4, page->va, zero_page, false))
+		return false;
+	zero_map_cnt++;
+	return true;
+}
+
+/* PAGE가 공유 zero 페이지에 매핑되어 있으면 매핑을 지운다.
+   pml4_destroy()가 매핑된 페이지를 해제하므로 페이지를 없애기 전에 불러야 한다. */
+void
+vm_zero_unmap (struct page *page) {
+	if (vm_zero_mapped (page))
+		pml4_clear_page (page->owner->pml4, page->va);
+}
+
 /* Handle the fault on write_protected page */
-/* write_protected 페이지의 오류 처리 */
+/* write_protected 페이지의 오류 처리
+   fork 후 부모와 자식은 프레임을 읽기 전용으로 공유한다(COW).
+   먼저 쓰려고 하는 쪽이 여기서 자기만의 복사본을 만든다. */
 static bool
 vm_handle_wp (struct page *page UNUSED) {
+	uint64_t *pml4 = page->owner->pml4;
+	struct frame *old, *frame;
+	bool success;
+
+	/* 원래 읽기 전용인 페이지에 쓰려고 했다면 진짜 폴트 */
+	if (!page->writable)
+		return false;
+
+	lock_acquire (&frame_lock);
+	page_io_wait (page);
+	old = page->frame;
+
+	/* 그 사이 공유 프레임이 쫓겨났다면 다시 읽어 오면 그대로 내 것이 된다.
+	   공유 zero 페이지를 보고 있었다면 매핑을 지우고 자기 프레임을 받는다. */
+	if (old == NULL) {
+		lock_release (&frame_lock);
+		if (vm_zero_mapped (page)) {
+			pml4_clear_page (pml4, page->va);
+			zero_cow_cnt++;
+		}
+		return vm_do_claim_page (page);
+	}
+
+	/* 프레임을 나 혼자 쓰고 있다면 복사할 필요 없이 쓰기 권한만 돌려준다.
+	   PTE를 다시 만들면 더티 비트가 지워지므로 먼저 프레임에 모아 둔다. */
+	if (list_front (&old->pages) == list_back (&old->pages)) {
+		old->dirty |= pml4_is_dirty (pml4, page->va);
+		success = pml4_set_page (pml4, page->va, old->kva, true);
+		lock_release (&frame_lock);
+		return success;
+	}
+
+	/* 새 프레임을 구하는 동안 원래 프레임이 쫓겨나지 않게 고정한다. */
+	old->pin_cnt++;
+	lock_release (&frame_lock);
+
+	/* 공유 프레임의 내용을 복사하고 내 PTE만 새 프레임을 가리키게 한다. */
+	frame = vm_get_frame ();
+	memcpy (frame->kva, old->kva, PGSIZE);
+
+	lock_acquire (&frame_lock);
+	old->pin_cnt--;
+	frame->dirty = old->dirty;
+	frame_unlink (old, page);
+
+	frame->page = page;
+	frame->owner = page->owner;
+	page->frame = frame;
+	list_push_back (&frame->pages, &page->share_elem);
+	evict_insert (frame);
+	success = pml4_set_page (pml4, page->va, frame->kva, true);
+	frame->pin_cnt--;
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* 커널이 유저 버퍼에 쓰기 전에 부른다.
+   CR0.WP가 꺼져 있어서 커널의 쓰기는 읽기 전용 PTE에서 폴트가 나지 않는다.
+   그래서 공유 중인(COW) 페이지라면 여기서 미리 복사본을 만든다. */
+bool
+vm_prepare_write (struct page *page) {
+	uint64_t *pte;
+
+	vm_page_wait (page);
+	if (!page->writable)
+		return true;
+	if (page->frame == NULL)
+		return vm_zero_mapped (page) ? vm_handle_wp (page) : true;
+
+	pte = pml4e_walk (page->owner->pml4, (uint64_t) page->va, 0);
+	if (pte != NULL && is_writable (pte))
+		return true;
+	return vm_handle_wp (page);
 }
 
 /* Return true on success */
@@ -269,6 +1101,16 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	/* 페이지 폴트가 커널 영역에서 났는지, 유저 영역에서 났는지 확인!*/
     void *rsp_stack = is_kernel_vaddr(f->rsp) ? thread_current()->rsp_stack : f->rsp;
     if (not_present){
+		/* 익명 영역의 빈 2 MB 구간이면 한 번에 채운다. */
+		if (spt_find_page (spt, addr) == NULL && vm_huge_fault (spt, addr))
+			return true;
+		page = spt_lookup_page (spt, addr);
+		/* prefetchd가 읽고 있던 페이지이면 기다린다. 다 읽었으면 이미 매핑되어 있다. */
+		if (page != NULL && vm_page_wait (page) && page->frame != NULL)
+			return true;
+		/* 0으로 채울 페이지를 읽기만 하면 공유 zero 페이지를 매핑한다. */
+		if (!write && page != NULL && vm_map_zero (page))
+			return true;
         if (!vm_claim_page(addr)) {
 			/* Page fault 발생 주소가 유저 스택 내에 있고, 스택 포인터보다 8바이트 밑에 있지 않으면 */
             if (rsp_stack - 8 <= addr && USER_STACK - 0x100000 <= addr && addr <= USER_STACK) {
@@ -280,6 +1122,10 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
         else
             return true;
     }
+
+	/* 있는 페이지에 쓰다가 난 폴트 → COW로 공유 중인 페이지인지 확인 */
+	if (write && (page = spt_find_page (spt, addr)) != NULL)
+		return vm_handle_wp (page);
     return false;
     // return vm_do_claim_page (page);
 }
@@ -299,7 +1145,7 @@ vm_claim_page (void *va UNUSED) {
 	struct page *page = NULL;
 	// struct thread *t = thread_current();
 	/* TODO: Fill this function */
-	page = spt_find_page(&thread_current()->spt, va);
+	page = spt_lookup_page(&thread_current()->spt, va);
 
 	if (page == NULL){ 
 
@@ -308,22 +1154,700 @@ vm_claim_page (void *va UNUSED) {
 	return vm_do_claim_page (page);
 }
 
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *f = hash_entry (e, struct frame, text_elem);
+
+	return hash_bytes (&f->text_inode, sizeof f->text_inode)
+		^ hash_int (f->text_ofs) ^ hash_int (f->text_bytes);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_, void *aux UNUSED) {
+	const struct frame *a = hash_entry (a_, struct frame, text_elem);
+	const struct frame *b = hash_entry (b_, struct frame, text_elem);
+
+	if (a->text_inode != b->text_inode)
+		return a->text_inode < b->text_inode;
+	if (a->text_ofs != b->text_ofs)
+		return a->text_ofs < b->text_ofs;
+	return a->text_bytes < b->text_bytes;
+}
+
+/* C의 내용을 담고 있는 공유 text 프레임. 없으면 NULL. frame_lock을 잡고 불러야 한다. */
+static struct frame *
+text_lookup (struct container *c) {
+	struct frame key;
+	struct hash_elem *e;
+
+	key.text_inode = file_get_inode (c->file);
+	key.text_ofs = c->offset;
+	key.text_bytes = c->page_read_bytes;
+	e = hash_find (&text_frames, &key.text_elem);
+	return e != NULL ? hash_entry (e, struct frame, text_elem) : NULL;
+}
+
+/* FRAME을 공유 text 기록에서 뺀다. frame_lock을 잡고 불러야 한다. */
+static void
+text_forget (struct frame *frame) {
+	if (frame->text_inode != NULL) {
+		hash_delete (&text_frames, &frame->text_elem);
+		frame->text_inode = NULL;
+	}
+}
+
+/* C의 내용을 담은 공유 text 프레임이 이미 있으면 true. */
+bool
+vm_text_cached (struct container *c) {
+	bool cached;
+
+	lock_acquire (&frame_lock);
+	cached = text_lookup (c) != NULL;
+	lock_release (&frame_lock);
+	return cached;
+}
+
+/* C의 내용을 막 읽어 넣은 FRAME을 공유 text로 기록한다.
+   같은 내용의 프레임이 이미 있으면 (동시에 읽은 경우) 그냥 둔다. */
+void
+vm_text_register (struct frame *frame, struct container *c) {
+	lock_acquire (&frame_lock);
+	if (frame->text_inode == NULL && text_lookup (c) == NULL) {
+		frame->text_inode = file_get_inode (c->file);
+		frame->text_ofs = c->offset;
+		frame->text_bytes = c->page_read_bytes;
+		hash_insert (&text_frames, &frame->text_elem);
+	}
+	lock_release (&frame_lock);
+}
+
+/* PAGE가 공유 text 페이지이고 다른 프로세스가 같은 내용을 이미 읽어 두었으면
+   그 프레임을 읽기 전용으로 같이 매핑하고 true. */
+static bool
+vm_claim_shared (struct page *page) {
+	bool uninit = VM_TYPE (page->operations->type) == VM_UNINIT;
+	struct container *c = page->uninit.aux;
+	struct frame *frame;
+
+	if (page_get_type (page) != VM_FILE || (uninit && page->uninit.init != lazy_load_segment)
+			|| !c->shared)
+		return false;
+
+	lock_acquire (&frame_lock);
+	frame = text_lookup (c);
+	if (frame != NULL && pml4_set_page (page->owner->pml4, page->va, frame->kva, false)) {
+		if (uninit)
+			page->uninit.page_initializer (page, page->uninit.type, frame->kva);
+		page->frame = frame;
+		list_push_back (&frame->pages, &page->share_elem);
+		text_share_cnt++;
+	}
+	else
+		frame = NULL;
+	lock_release (&frame_lock);
+	return frame != NULL;
+}
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct frame, ksm_elem)->ksm_sum;
+}
+
+static bool
+ksm_less (const struct hash_elem *a, const struct hash_elem *b, void *aux UNUSED) {
+	return hash_entry (a, struct frame, ksm_elem)->ksm_sum
+		< hash_entry (b, struct frame, ksm_elem)->ksm_sum;
+}
+
+/* FRAME을 ksm_frames에서 뺀다. frame_lock을 잡고 불러야 한다. */
+static void
+ksm_forget (struct frame *frame) {
+	if (frame->ksm_listed) {
+		hash_delete (&ksm_frames, &frame->ksm_elem);
+		frame->ksm_listed = false;
+	}
+}
+
+/* FRAME이 다 채워진 익명 페이지를 담고 있고, 매핑한 프로세스가 모두
+   시스템 콜 밖에 있으면 true. frame_lock을 잡고 불러야 한다. */
+static bool
+ksm_candidate (struct frame *frame) {
+	struct list_elem *e;
+
+	if (frame->page == NULL || frame->pin_cnt > 0 || frame->huge
+			|| frame->page->operations->type != VM_ANON)
+		return false;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages); e = list_next (e)) {
+		struct thread *owner = list_entry (e, struct page, share_elem)->owner;
+
+		if (owner->pml4 == NULL || owner->in_syscall)
+			return false;
+	}
+	return true;
+}
+
+/* FRAME을 매핑한 PTE를 모두 읽기 전용으로 바꾼다.
+   PTE를 다시 만들면 더티 비트가 지워지므로 먼저 프레임에 모아 둔다. */
+static void
+ksm_protect (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, share_elem);
+		uint64_t *pml4 = p->owner->pml4;
+
+		frame->dirty |= pml4_is_dirty (pml4, p->va);
+		pml4_set_page (pml4, p->va, frame->kva, false);
+	}
+}
+
+/* FRAME의 페이지들을 같은 내용의 INTO에 읽기 전용으로 옮겨 매핑하고
+   FRAME을 풀에 돌려준다. 둘 다 ksm_protect()를 거친 뒤여야 한다. */
+static void
+ksm_merge (struct frame *frame, struct frame *into) {
+	into->dirty |= frame->dirty;
+	while (!list_empty (&frame->pages)) {
+		struct page *p = list_entry (list_pop_front (&frame->pages), struct page, share_elem);
+
+		pml4_set_page (p->owner->pml4, p->va, into->kva, false);
+		p->frame = into;
+		list_push_back (&into->pages, &p->share_elem);
+		ksm_merge_cnt++;
+	}
+	evict_remove (frame);
+	frame_free (frame);
+}
+
+/* FRAME을 살펴보고 같은 내용의 프레임이 기록되어 있으면 합친다.
+   frame_lock을 잡고 불러야 한다. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct frame *other = NULL;
+	struct hash_elem *e;
+	uint64_t sum;
+
+	ksm_forget (frame);
+	if (!ksm_candidate (frame))
+		return;
+
+	/* 지난번 방문 뒤로 내용이 바뀌었으면 아직 자주 쓰이는 페이지이니 기억만 해 둔다. */
+	ksm_scan_cnt++;
+	sum = hash_bytes (frame->kva, PGSIZE);
+	if (sum != frame->ksm_sum) {
+		frame->ksm_sum = sum;
+		return;
+	}
+
+	/* 기록된 프레임은 그 뒤에 바뀌었을 수 있으므로 쓰기를 막은 다음 비교한다. */
+	e = hash_find (&ksm_frames, &frame->ksm_elem);
+	if (e != NULL) {
+		other = hash_entry (e, struct frame, ksm_elem);
+		if (ksm_candidate (other)) {
+			ksm_protect (other);
+			ksm_protect (frame);
+			if (memcmp (other->kva, frame->kva, PGSIZE) == 0) {
+				ksm_merge (frame, other);
+				return;
+			}
+		}
+		ksm_forget (other);
+	}
+	hash_insert (&ksm_frames, &frame->ksm_elem);
+	frame->ksm_listed = true;
+}
+
+/* KSM_SLEEP tick마다 프레임 vm_ksm_pages개를 살펴본다.
+   한 프레임마다 frame_lock을 놓아서 폴트를 오래 막지 않는다. */
+static void
+ksm_daemon (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep (KSM_SLEEP);
+		for (size_t i = 0; i < vm_ksm_pages; i++) {
+			lock_acquire (&frame_lock);
+			ksm_scan_frame (&frame_table[ksm_cursor]);
+			if (++ksm_cursor == frame_cnt) {
+				ksm_cursor = 0;
+				ksm_pass_cnt++;
+			}
+			lock_release (&frame_lock);
+		}
+	}
+}
+
 /* Claim the PAGE and set up the mmu. */
 /* PAGE를 요청하고 mmu를 설정합니다. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
-	struct thread *t = thread_current();
+	struct frame *frame;
+	uint64_t *pml4 = page->owner->pml4;
+	bool success = false;
+
+	if (vm_claim_shared (page))
+		return true;
+	frame = vm_get_frame ();
 	/* Set links */
+	/* 프레임은 고정되어 있으므로 다 채울 때까지 쫓겨나지 않는다. */
+	lock_acquire (&frame_lock);
 	frame->page = page;
+	frame->owner = page->owner;
 	page->frame = frame;
+	list_push_back (&frame->pages, &page->share_elem);
+	evict_insert (frame);
+	lock_release (&frame_lock);
 	/* TODO: Insert page table entry to map page's VA to frame's PA. */
 
-	if (pml4_get_page(t->pml4, page->va) == NULL &&  pml4_set_page (t->pml4, page->va, frame->kva, page->writable)){
+	if (pml4_get_page(pml4, page->va) == NULL &&  pml4_set_page (pml4, page->va, frame->kva, page->writable)){
 
-		return swap_in(page, frame->kva);
+		success = swap_in(page, frame->kva);
+	}
+	/* 처음 읽은 공유 text는 다른 프로세스가 찾을 수 있게 기록한다. */
+	if (success && page_get_type (page) == VM_FILE
+			&& ((struct container *) page->uninit.aux)->shared)
+		vm_text_register (frame, page->uninit.aux);
+	vm_frame_unpin (frame);
+	return success;
+}
+
+/* PAGE를 prefetchd가 읽고 있거나 PAGE의 프레임을 디스크에 쓰고 있으면
+   끝날 때까지 기다린다. frame_lock을 잡고 불러야 한다. 기다렸으면 true. */
+static bool
+page_io_wait (struct page *page) {
+	bool waited = false;
+
+	while (page->prefetch || (page->frame != NULL && page->frame->io)) {
+		cond_wait (&page_io_done, &frame_lock);
+		waited = true;
+	}
+	return waited;
+}
+
+/* page_io_wait()와 같지만 frame_lock을 직접 잡는다. */
+bool
+vm_page_wait (struct page *page) {
+	bool waited;
+
+	lock_acquire (&frame_lock);
+	waited = page_io_wait (page);
+	lock_release (&frame_lock);
+	return waited;
+}
+
+/* 메모리에 없는 PAGE를 prefetchd가 읽도록 맡긴다.
+   읽을 것이 없는 페이지(이미 있거나 0으로 채울 페이지)는 그냥 두고,
+   다른 프로세스가 읽어 둔 공유 text는 그 자리에서 같이 매핑한다.
+   빈 프레임이 넉넉하지 않으면 다른 페이지를 쫓아내지 않고 false를 돌려준다. */
+static bool
+vm_prefetch (struct page *page) {
+	struct prefetch_req *req;
+	struct frame *frame;
+
+	if (page->frame != NULL || page_is_zero_fill (page)
+			|| pml4_get_page (page->owner->pml4, page->va) != NULL || vm_claim_shared (page))
+		return true;
+	if ((frame = vm_get_free_frame ()) == NULL)
+		return false;
+	if ((req = malloc (sizeof *req)) == NULL) {
+		vm_put_free_frame (frame);
+		return false;
+	}
+	req->page = page;
+	req->frame = frame;
+
+	lock_acquire (&frame_lock);
+	frame->page = page;
+	frame->owner = page->owner;
+	page->frame = frame;
+	list_push_back (&frame->pages, &page->share_elem);
+	page->prefetch = true;
+	list_push_back (&prefetch_queue, &req->elem);
+	prefetch_queue_cnt++;
+	lock_release (&frame_lock);
+	sema_up (&prefetch_sema);
+	return true;
+}
+
+/* 큐에 든 페이지를 하나씩 읽어 주인의 페이지 테이블에 매핑한다.
+   읽지 못하면 프레임을 떼어내서 다음 폴트가 평소처럼 읽게 한다. */
+static void
+prefetch_daemon (void *aux UNUSED) {
+	for (;;) {
+		struct prefetch_req *req;
+		struct page *page;
+		struct frame *frame;
+		bool success;
+
+		sema_down (&prefetch_sema);
+		lock_acquire (&frame_lock);
+		req = list_entry (list_pop_front (&prefetch_queue), struct prefetch_req, elem);
+		lock_release (&frame_lock);
+		page = req->page;
+		frame = req->frame;
+		free (req);
+
+		/* 주인은 이 페이지가 끝날 때까지 폴트를 내거나 페이지를 없애지 않는다. */
+		success = swap_in (page, frame->kva);
+		if (success && page_get_type (page) == VM_FILE
+				&& ((struct container *) page->uninit.aux)->shared)
+			vm_text_register (frame, page->uninit.aux);
+
+		lock_acquire (&frame_lock);
+		success = success
+			&& pml4_set_page (page->owner->pml4, page->va, frame->kva, page->writable);
+		frame->pin_cnt--;
+		if (success) {
+			evict_insert (frame);
+			prefetch_read_cnt++;
+		}
+		else
+			frame_unlink (frame, page);
+		page->prefetch = false;
+		cond_broadcast (&page_io_done, &frame_lock);
+		lock_release (&frame_lock);
+	}
+}
+
+/* 파일 PAGE를 지금 메모리에서 내보낸다. 더티이면 파일에 쓴다.
+   다른 페이지와 프레임을 공유하면 PAGE의 매핑만 지운다.
+   메모리에 없거나 고정된 프레임이면 그대로 두고 false. */
+bool
+vm_page_drop (struct page *page) {
+	struct frame *frame;
+	bool dropped = false;
+
+	ASSERT (page_get_type (page) == VM_FILE);
+
+	lock_acquire (&frame_lock);
+	frame = page->frame;
+	if (frame != NULL && frame->pin_cnt == 0) {
+		if (list_front (&frame->pages) != list_back (&frame->pages)) {
+			frame->dirty |= pml4_is_dirty (page->owner->pml4, page->va);
+			pml4_clear_page (page->owner->pml4, page->va);
+			frame_unlink (frame, page);
+			dropped = true;
+		}
+		else {
+			/* vm_evict_frame()처럼 프레임을 고정하고 잠금을 놓은 채 파일에 쓴다. */
+			evict_remove (frame);
+			frame->pin_cnt++;
+			frame->io = true;
+			text_forget (frame);
+			ksm_forget (frame);
+			lock_release (&frame_lock);
+			dropped = swap_out (page);
+			lock_acquire (&frame_lock);
+			frame->pin_cnt--;
+			frame->io = false;
+			cond_broadcast (&page_io_done, &frame_lock);
+			if (dropped)
+				frame_free (frame);
+			else
+				evict_insert (frame);
+		}
+	}
+	lock_release (&frame_lock);
+	return dropped;
+}
+
+/* MADV_DONTNEED: PAGE가 가진 프레임과 스왑 슬롯을 바로 돌려준다.
+   파일 페이지는 (더티면 파일에 쓰고) 메모리에서 내보내므로 다음 폴트에 파일에서 다시 읽는다.
+   익명 페이지는 내용을 버리고 처음 상태로 다시 만든다. 쓰기 가능한 ELF 세그먼트는
+   container(aux)가 남아 있어 파일에서 다시 읽고, 나머지는 0으로 채워진다. */
+static bool
+page_dontneed (struct page *page, void *spt_) {
+	struct supplemental_page_table *spt = spt_;
+	enum vm_type type = VM_TYPE (page->operations->type);
+
+	if (type == VM_FILE) {
+		if (vm_page_drop (page))
+			dontneed_cnt++;
+	}
+	else if (type == VM_ANON) {
+		void *va = page->va;
+		bool writable = page->writable;
+		void *aux = page->uninit.aux;
+
+		spt_remove_page (spt, page);
+		if (!vm_alloc_page_with_initializer (VM_ANON, va, writable,
+				aux != NULL ? lazy_load_segment : NULL, aux))
+			return false;
+		dontneed_cnt++;
+	}
+	return true;
+}
+
+/* 현재 프로세스의 [ADDR, ADDR + LENGTH)에 대한 접근 패턴 힌트(MADV_*)를 처리한다.
+   ADDR은 페이지 정렬되어 있어야 한다.
+   모르는 힌트이거나 DONTNEED로 비운 페이지를 다시 만들지 못하면 false. */
+bool
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = addr + ROUND_UP (length, PGSIZE);
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			vma_advise (spt, addr, end, advice);
+			return true;
+
+		case MADV_WILLNEED:
+			for (void *va = addr; va < end; va += PGSIZE) {
+				struct page *page = spt_lookup_page (spt, va);
+
+				if (page != NULL && !vm_prefetch (page))
+					break;
+			}
+			return true;
+
+		case MADV_DONTNEED:
+			return spt_for_each (spt, addr, end, page_dontneed, spt);
+
+		default:
+			return false;
+	}
+}
+
+/* FRAME이 파일에 다시 써야 하는 mmap 페이지를 담고 있으면 true.
+   frame_lock을 잡고 불러야 한다. */
+static bool
+frame_needs_flush (struct frame *frame) {
+	struct page *page = frame->page;
+
+	return page != NULL && frame->pin_cnt == 0
+		&& VM_TYPE (page->operations->type) == VM_FILE
+		&& !((struct container *) page->uninit.aux)->shared
+		&& frame_is_dirty (frame);
+}
+
+/* FRAME과 그것을 매핑한 PTE들의 더티 표시를 지운다. */
+static void
+frame_clear_dirty (struct frame *frame) {
+	struct list_elem *e;
+
+	frame->dirty = false;
+	for (e = list_begin (&frame->pages); e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, share_elem);
+
+		if (p->owner->pml4 != NULL)
+			pml4_set_dirty (p->owner->pml4, p->va, false);
+	}
+}
+
+/* 파일(inode)과 오프셋 순서로 A가 B보다 앞이면 true. */
+static bool
+flush_less (struct frame *a, struct frame *b) {
+	struct container *ca = a->page->uninit.aux;
+	struct container *cb = b->page->uninit.aux;
+	struct inode *ia = file_get_inode (ca->file);
+	struct inode *ib = file_get_inode (cb->file);
+
+	return ia != ib ? ia < ib : ca->offset < cb->offset;
+}
+
+/* B가 파일에서 A 바로 뒤에 이어지면 true. */
+static bool
+flush_adjacent (struct frame *a, struct frame *b) {
+	struct container *ca = a->page->uninit.aux;
+	struct container *cb = b->page->uninit.aux;
+
+	return file_get_inode (ca->file) == file_get_inode (cb->file)
+		&& ca->page_read_bytes == PGSIZE && cb->offset == ca->offset + PGSIZE;
+}
+
+/* file_write_at() 한 번으로 쓸, 파일에서 이어지는 프레임들. */
+struct flush_run {
+	struct file *file;
+	off_t offset;
+	size_t first;	/* flush_buf에서 시작하는 페이지 */
+	size_t bytes;
+};
+
+/* 더티인 mmap 프레임 FRAMES[0..CNT)를 파일에 쓴다.
+   flush_lock과 frame_lock을 잡고 불러야 하고, 쓰는 동안은 frame_lock을 놓는다.
+   frame_lock을 잡은 채로는 파일 순서로 정렬하고, 프레임을 고정한 뒤 flush_buf에
+   복사만 한다. 이어지는 프레임들은 버퍼에서도 이어지므로 파일 쓰기 한 번이면 된다.
+   더티 비트를 먼저 지우고 복사하므로 그 사이의 쓰기는 다음 번에 다시 쓰인다. */
+static void
+flush_frames (struct frame **frames, size_t cnt) {
+	struct flush_run runs[FLUSH_BATCH];
+	size_t run_cnt = 0;
+
+	ASSERT (cnt <= FLUSH_BATCH);
+	ASSERT (lock_held_by_current_thread (&flush_lock));
+
+	for (size_t i = 1; i < cnt; i++)
+		for (size_t j = i; j > 0 && flush_less (frames[j], frames[j - 1]); j--) {
+			struct frame *tmp = frames[j];
+			frames[j] = frames[j - 1];
+			frames[j - 1] = tmp;
+		}
+
+	for (size_t i = 0; i < cnt; i++) {
+		struct frame *frame = frames[i];
+		struct container *c = frame->page->uninit.aux;
+
+		if (i == 0 || !flush_adjacent (frames[i - 1], frame)) {
+			runs[run_cnt].file = c->file;
+			runs[run_cnt].offset = c->offset;
+			runs[run_cnt].first = i;
+			run_cnt++;
+		}
+		runs[run_cnt - 1].bytes = (i - runs[run_cnt - 1].first) * PGSIZE + c->page_read_bytes;
+
+		frame->pin_cnt++;
+		frame->io = true;
+		frame_clear_dirty (frame);
+		memcpy (flush_buf + i * PGSIZE, frame->kva, c->page_read_bytes);
+	}
+
+	lock_release (&frame_lock);
+	for (size_t r = 0; r < run_cnt; r++)
+		file_write_at (runs[r].file, flush_buf + runs[r].first * PGSIZE,
+				runs[r].bytes, runs[r].offset);
+	lock_acquire (&frame_lock);
+
+	for (size_t i = 0; i < cnt; i++) {
+		frames[i]->pin_cnt--;
+		frames[i]->io = false;
+	}
+	cond_broadcast (&page_io_done, &frame_lock);
+	flush_write_cnt += run_cnt;
+	flush_page_cnt += cnt;
+}
+
+/* vm_flush_interval tick마다 프레임 표 전체에서 더티인 mmap 페이지를 쓴다.
+   frame_lock은 FLUSH_BATCH개를 고르고 복사하는 동안만 잡으므로 폴트를 오래 막지 않는다. */
+static void
+flush_daemon (void *aux UNUSED) {
+	struct frame *frames[FLUSH_BATCH];
+
+	for (;;) {
+		timer_sleep (vm_flush_interval);
+		for (size_t i = 0; i < frame_cnt; ) {
+			size_t cnt = 0;
+
+			lock_acquire (&flush_lock);
+			lock_acquire (&frame_lock);
+			for (; i < frame_cnt && cnt < FLUSH_BATCH; i++)
+				if (frame_needs_flush (&frame_table[i]))
+					frames[cnt++] = &frame_table[i];
+			if (cnt > 0)
+				flush_frames (frames, cnt);
+			lock_release (&frame_lock);
+			lock_release (&flush_lock);
+		}
+	}
+}
+
+struct flush_range {
+	struct frame *frames[FLUSH_BATCH];
+	size_t cnt;
+};
+
+static bool
+flush_collect (struct page *page, void *range_) {
+	struct flush_range *range = range_;
+
+	if (page->frame != NULL && frame_needs_flush (page->frame)) {
+		range->frames[range->cnt++] = page->frame;
+		if (range->cnt == FLUSH_BATCH) {
+			flush_frames (range->frames, range->cnt);
+			range->cnt = 0;
+		}
+	}
+	return true;
+}
+
+/* SPT(현재 스레드의 것)의 [START, END)에 있는 더티 mmap 페이지를 파일에 쓴다.
+   msync와 munmap, exit에서 부른다. 주소 순서가 곧 영역 안의 파일 순서이다. */
+void
+vm_flush_range (struct supplemental_page_table *spt, void *start, void *end) {
+	struct flush_range range;
+
+	range.cnt = 0;
+	lock_acquire (&flush_lock);
+	lock_acquire (&frame_lock);
+	spt_for_each (spt, start, end, flush_collect, &range);
+	if (range.cnt > 0)
+		flush_frames (range.frames, range.cnt);
+	lock_release (&frame_lock);
+	lock_release (&flush_lock);
+}
+
+/* 교체 정책이 곧 쫓아낼 후보로 본 FRAME이 더티이다. cleand가 미리 써 두도록 맡긴다.
+   frame_lock을 잡고 불러야 한다. 이미 맡겼거나 큐가 차 있으면 그냥 둔다. */
+void
+frame_start_clean (struct frame *frame) {
+	if (frame->clean_queued || clean_queue_len == CLEAN_QUEUE)
+		return;
+	frame->clean_queued = true;
+	clean_queue[(clean_head + clean_queue_len++) % CLEAN_QUEUE] = frame;
+	clean_start_cnt++;
+	sema_up (&clean_sema);
+}
+
+/* FRAME이 미리 스왑에 써 둘 익명 페이지를 담고 있으면 true.
+   frame_lock을 잡고 불러야 한다. */
+static bool
+frame_needs_clean (struct frame *frame) {
+	return frame->page != NULL && frame->pin_cnt == 0 && !frame->huge
+		&& page_get_type (frame->page) == VM_ANON
+		&& frame_is_dirty (frame);
+}
+
+/* clean_queue에서 FLUSH_BATCH개까지 꺼내 파일 페이지는 flush_frames()로,
+   익명 페이지는 anon_swap_clean()으로 써 둔다. 쓰는 동안은 frame_lock을 놓고
+   프레임은 고정(frame->io)해 둔다. 더티 비트를 먼저 지우므로 쓰는 사이에
+   다시 쓰인 페이지는 쫓겨날 때 더티로 보인다. */
+static void
+clean_daemon (void *aux UNUSED) {
+	struct frame *files[FLUSH_BATCH];
+	struct frame *anons[FLUSH_BATCH];
+	int slots[FLUSH_BATCH];
+
+	for (;;) {
+		size_t file_cnt = 0, anon_cnt = 0;
+
+		sema_down (&clean_sema);
+		lock_acquire (&flush_lock);
+		lock_acquire (&frame_lock);
+		while (clean_queue_len > 0 && file_cnt < FLUSH_BATCH && anon_cnt < FLUSH_BATCH) {
+			struct frame *frame = clean_queue[clean_head];
+
+			clean_head = (clean_head + 1) % CLEAN_QUEUE;
+			clean_queue_len--;
+			frame->clean_queued = false;
+			if (frame_needs_flush (frame))
+				files[file_cnt++] = frame;
+			else if (frame_needs_clean (frame)) {
+				frame->pin_cnt++;
+				frame->io = true;
+				frame_clear_dirty (frame);
+				anons[anon_cnt++] = frame;
+			}
+		}
+		if (file_cnt > 0)
+			flush_frames (files, file_cnt);
+		lock_release (&frame_lock);
+
+		for (size_t i = 0; i < anon_cnt; i++)
+			slots[i] = anon_swap_clean (anons[i]);
+
+		lock_acquire (&frame_lock);
+		for (size_t i = 0; i < anon_cnt; i++) {
+			/* 쓰지 못했으면 지운 더티 표시를 되돌려 놓는다. */
+			if (slots[i] >= 0)
+				anons[i]->swap_slot = slots[i];
+			else
+				anons[i]->dirty = true;
+			anons[i]->pin_cnt--;
+			anons[i]->io = false;
+		}
+		if (anon_cnt > 0)
+			cond_broadcast (&page_io_done, &frame_lock);
+		lock_release (&frame_lock);
+		lock_release (&flush_lock);
 	}
-	return false;
 }
 
 /* Initialize new supplemental page table */
@@ -332,47 +1856,81 @@ supplemental : 보조*/
 void
 supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
 	// struct hash* page_table = malloc(sizeof (struct hash));
-	hash_init(&spt->hashs, page_hash, page_less, NULL);
-	
-	
+	spt->root = NULL;
+	spt->hint = NULL;
+	spt->hint_key = 0;
+	spt->page_cnt = 0;
+	list_init (&spt->vmas);
+}
+
+/* 부모 페이지 PARENT_PAGE 하나를 자식(현재 스레드)의 spt인 DST에 복사한다. */
+static bool
+spt_copy_page (struct page *parent_page, void *dst_) {
+	struct supplemental_page_table *dst = dst_;
+	struct thread *child = thread_current ();
+	struct frame *frame;
+	struct page *child_page;
+
+	child_page = (struct page *)malloc (sizeof(struct page));
+	if (child_page == NULL)
+		return false;
+
+	/* 타입별 정보(union)까지 그대로 가져오고 주인만 자식으로 바꾼다. */
+	memcpy (child_page, parent_page, sizeof(struct page));
+	child_page->owner = child;
+	child_page->frame = NULL;
+	child_page->ghost = 0;
+
+	/* 파일 페이지(mmap, text)는 페이지마다 자기 container를 갖는다. */
+	if (page_get_type (child_page) == VM_FILE && !vma_page_copy (dst, child_page)) {
+		free (child_page);
+		return false;
+	}
+
+	lock_acquire (&frame_lock);
+	page_io_wait (parent_page);
+	frame = parent_page->frame;
+	if (frame != NULL) {
+		/* 부모와 자식 모두 읽기 전용으로 같은 프레임을 매핑한다.
+		   부모 PTE를 다시 만들면 더티 비트가 지워지므로 먼저 프레임에 모아 둔다. */
+		uint64_t *parent_pml4 = parent_page->owner->pml4;
+
+		/* 2 MB 페이지는 페이지마다 읽기 전용으로 바꿔야 하므로 나눈다. */
+		huge_demote (frame);
+		if (!pml4_set_page (child->pml4, child_page->va, frame->kva, false)) {
+			lock_release (&frame_lock);
+			if (page_get_type (child_page) == VM_FILE)
+				free (child_page->uninit.aux);
+			free (child_page);
+			return false;
+		}
+		frame->dirty |= pml4_is_dirty (parent_pml4, parent_page->va);
+		pml4_set_page (parent_pml4, parent_page->va, frame->kva, false);
+
+		child_page->frame = frame;
+		list_push_back (&frame->pages, &child_page->share_elem);
+	}
+	else if (parent_page->operations->type == VM_ANON)
+		anon_swap_ref (child_page);	// 스왑되어 있던 페이지는 슬롯을 공유
+	lock_release (&frame_lock);
+
+	if (!spt_insert_page (dst, child_page)) {
+		vm_dealloc_page (child_page);
+		return false;
+	}
+	return true;
 }
 
 /* Copy supplemental page table from src to dst */
-/* src에서 dst로 추가 페이지 테이블 복사 */
+/* src에서 dst로 추가 페이지 테이블 복사
+   메모리에 올라와 있는 페이지는 복사하지 않고 부모와 프레임을 읽기 전용으로 공유한다(COW).
+   둘 중 먼저 쓰는 쪽이 vm_handle_wp()에서 자기 복사본을 만든다. */
 bool
 supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
 		struct supplemental_page_table *src UNUSED) {	
-
-	struct hash_iterator i;
-    hash_first (&i, &src->hashs);
-    while (hash_next (&i)) {	// src의 각각의 페이지를 반복문을 통해 복사
-        struct page *parent_page = hash_entry (hash_cur (&i), struct page, hash_elem);   // 현재 해시 테이블의 element 리턴
-        enum vm_type type = page_get_type(parent_page);		// 부모 페이지의 type
-        void *upage = parent_page->va;						// 부모 페이지의 가상 주소
-        bool writable = parent_page->writable;				// 부모 페이지의 쓰기 가능 여부
-        vm_initializer *init = parent_page->uninit.init;	// 부모의 초기화되지 않은 페이지들 할당 위해 
-        void* aux = parent_page->uninit.aux;
-
-        if (parent_page->uninit.type & VM_MARKER_0) {
-            setup_stack(&thread_current()->tf);
-        }
-        else if(parent_page->operations->type == VM_UNINIT) {	// 부모 타입이 uninit인 경우
-            if(!vm_alloc_page_with_initializer(type, upage, writable, init, aux))
-                return false;
-        }
-        else {
-            if(!vm_alloc_page(type, upage, writable))
-                return false;
-            if(!vm_claim_page(upage))
-                return false;
-        }
-
-        if (parent_page->operations->type != VM_UNINIT) {   //! UNIT이 아닌 모든 페이지(stack 포함)는 부모의 것을 memcpy
-            struct page* child_page = spt_find_page(dst, upage);
-            memcpy(child_page->frame->kva, parent_page->frame->kva, PGSIZE);
-        }
-    }
-	return true;
+	/* src의 각각의 페이지를 주소 순으로 돌면서 복사 */
+	return vma_copy (dst, src)
+		&& spt_for_each (src, NULL, (void *) KERN_BASE, spt_copy_page, dst);
 }
 
 
@@ -383,90 +1941,93 @@ supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
 	/* TODO: Destroy all the supplemental_page_table hold by thread and
 	 * TODO: writeback all the modified contents to the storage. */
 	/* 스레드가 보유한 모든 supplemental_page_table을 삭제하고 
-	수정된 모든 내용을 스토리지에 다시 기록합니다. */
-
-	struct hash_iterator i;
-	hash_first(&i, &spt->hashs);
-	while(hash_next(&i))
-	{
-		struct page *page = hash_entry(hash_cur(&i), struct page, hash_elem);
-		if(page->operations->type == VM_FILE)
-		{
-			do_munmap(page->va);
-		}
-	} 
-	
-	hash_clear(&spt->hashs, spt_destructor);
-}
+	수정된 모든 내용을 스토리지에 다시 기록합니다.
+	(파일 페이지의 기록과 프레임 해제는 각 타입의 destroy가 한다) */
+	struct list_elem *e;
 
-//hash_elem이 포함된 페이지를 free
-void 
-spt_destructor(struct hash_elem *e, void *aux) 
-{
-	const struct page *p = hash_entry(e, struct page, hash_elem);
-	free(p);
+	/* mmap 영역의 더티 페이지는 페이지마다 따로 쓰지 않고 파일 순서대로 묶어서 먼저 쓴다. */
+	for (e = list_begin (&spt->vmas); e != list_end (&spt->vmas); e = list_next (e)) {
+		struct vma *vma = list_entry (e, struct vma, elem);
+		vm_flush_range (spt, vma->start, vma->end);
+	}
+	if (spt->root != NULL)
+		spt_destroy (spt->root, SPT_LEVELS - 1);
+	vma_kill (spt);
+	supplemental_page_table_init (spt);
 }
 
-static bool
-setup_stack (struct intr_frame *if_) {
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
+/* PAGE를 자기 프레임에서 떼어낸다. PTE를 지우고,
+   더 이상 이 프레임을 공유하는 페이지가 없으면 프레임도 해제한다.
+   페이지를 없애기 전에 부르므로 교체 정책이 기억하던 이력도 지운다.
+   이 뒤로는 PAGE가 다시 쫓겨날 일이 없다. */
+void
+frame_detach (struct page *page) {
+	struct frame *frame;
 
-	bool success = false;
-	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
-	if (vm_alloc_page(VM_ANON | VM_MARKER_0, stack_bottom, 1)) {
-		success = vm_claim_page(stack_bottom);
-		if (success){
-			if_->rsp = USER_STACK;
-			thread_current()->stack_bottom = stack_bottom;
-		}
+	lock_acquire (&frame_lock);
+	page_io_wait (page);
+	frame = page->frame;
+	if (frame != NULL) {
+		if (page->owner->pml4 != NULL)
+			pml4_clear_page (page->owner->pml4, page->va);
+		frame_unlink (frame, page);
 	}
-		
-	return success;
+	evict_forget (page);
+	lock_release (&frame_lock);
 }
 
-// hash_elem를 넣으면 해당 페이지의 va에서 해시값을 추출 
-unsigned 
-page_hash (const struct hash_elem *e, void *aux){
-	const struct page *p = hash_entry (e, struct page, hash_elem);
-	
-	return hash_bytes(&p->va, sizeof(p->va));
-}
+/* 파일 PAGE의 프레임이 더티이면 파일에 쓴다. 없애기 전에 frame_detach()보다 먼저 부른다.
+   frame_lock을 잡은 채 프레임을 고정하고 더티 표시를 지운 뒤, 쓰는 동안은 잠금을 놓는다.
+   그 사이 reclaimd가 프레임을 쫓아내도 이미 깨끗하므로 두 번 쓰지 않는다. 썼으면 true. */
+bool
+frame_writeback (struct page *page) {
+	struct container *c = page->uninit.aux;
+	struct frame *frame;
+	bool written = false;
 
-//a와 b의 va를 비교해 b가 크면 참을 뱉음
-bool 
-page_less (const struct hash_elem *a, 
-	const struct hash_elem *b, void *aux){
-	
-	const struct page *p_a = hash_entry (a, struct page, hash_elem);
-	const struct page *p_b = hash_entry (b, struct page, hash_elem);
-	return p_a->va < p_b->va;
-}
+	ASSERT (page_get_type (page) == VM_FILE);
 
-bool 
-delete_page (struct hash *pages, struct page *p) {
-	if (hash_delete(pages, &p->hash_elem))
-		return false;
-	else
-		return true;
+	lock_acquire (&frame_lock);
+	page_io_wait (page);
+	frame = page->frame;
+	if (frame != NULL && frame_is_dirty (frame)) {
+		frame->pin_cnt++;
+		frame->io = true;
+		frame_clear_dirty (frame);
+		lock_release (&frame_lock);
+		file_write_at (c->file, frame->kva, c->page_read_bytes, c->offset);
+		lock_acquire (&frame_lock);
+		frame->pin_cnt--;
+		frame->io = false;
+		cond_broadcast (&page_io_done, &frame_lock);
+		written = true;
+	}
+	lock_release (&frame_lock);
+	return written;
 }
 
+/* Prints VM statistics. */
 void
-printf_hash (struct supplemental_page_table *spt) {
-  struct hash *h = &spt->hashs;
-  struct hash_iterator i;
-  hash_first (&i, h);
-  printf ("===== hash 순회시작 =====\n");
-  while (hash_next (&i)) {
-    struct page *p = hash_entry (hash_cur (&i), struct page, hash_elem);
-    if (p->frame == NULL) {
-      printf ("va: %X, writable : %X\n", p->va, p->writable);
-    } else {
-      printf ("va: %X, kva : %X, writable : %X\n", p->va, p->frame->kva,
-              p->writable);
-    }
-  }
-  printf ("===== hash 순회종료 =====\n");
-}
\ No newline at end of file
+vm_print_stats (void) {
+	evict_print_stats ();
+	printf ("Reclaim: %lld direct, %lld background, %lld wakeups\n",
+			direct_reclaim_cnt, background_reclaim_cnt, reclaim_wakeup_cnt);
+	printf ("Text: %lld shared faults, %zu frames shared\n",
+			text_share_cnt, hash_size (&text_frames));
+	printf ("Zero page: %lld read faults mapped, %lld copied on write\n",
+			zero_map_cnt, zero_cow_cnt);
+	printf ("KSM: %lld pages merged, %lld frames scanned, %lld passes\n",
+			ksm_merge_cnt, ksm_scan_cnt, ksm_pass_cnt);
+	printf ("Populate: %lld pages mapped in %lld reads\n",
+			populate_page_cnt, populate_read_cnt);
+	printf ("Flush: %lld pages written back in %lld writes\n",
+			flush_page_cnt, flush_write_cnt);
+	printf ("Clean: %lld dirty frames queued for writeback before eviction\n",
+			clean_start_cnt);
+	printf ("Huge: %zu pages live (%zu kB huge-page backed), %lld allocated, %lld split\n",
+			huge_live_cnt, huge_live_cnt * HPGSIZE / 1024, huge_alloc_cnt, huge_split_cnt);
+	printf ("Madvise: %lld pages queued for prefetch, %lld prefetched, %lld freed by DONTNEED\n",
+			prefetch_queue_cnt, prefetch_read_cnt, dontneed_cnt);
+	anon_print_stats ();
+	file_print_stats ();
+}
@@ -0,0 +1,169 @@
+/* zswap.c: Compressed in-memory cache in front of the swap disk.
+   익명 페이지를 내보낼 때 먼저 LZF로 압축해서 커널 메모리에 넣어 두고,
+   다시 필요해지면 디스크 대신 여기서 풀어 온다.
+   캐시가 한도(zswap_limit)를 넘으면 가장 오래전에 넣은 것부터 압축을 풀어
+   원래 스왑 슬롯에 써 준다(writeback).
+   항목은 스왑 슬롯 번호로 찾으며, 슬롯이 비워질 때(zswap_invalidate) 함께 없어진다.
+   fork 후 여러 페이지가 한 슬롯을 공유할 수 있으므로 읽어 가도 바로 지우지 않는다. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <lzf.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* 압축한 페이지 하나. */
+struct zentry {
+	struct list_elem lru_elem;	/* lru 목록의 elem (앞쪽이 오래된 것) */
+	int slot;					/* 이 항목이 대신하는 스왑 슬롯 */
+	size_t size;				/* data의 바이트 수 */
+	uint8_t data[];				/* 압축된 내용 */
+};
+
+/* 이보다 크게 압축되는 페이지는 캐시에 넣지 않고 바로 디스크로 보낸다. */
+#define ZSWAP_MAX_SIZE (PGSIZE * 3 / 4)
+
+size_t zswap_limit = SIZE_MAX;
+
+static struct disk *swap_disk;
+static struct zentry **zslot;	/* 슬롯 번호 -> 항목 */
+static struct list lru;
+static size_t used;				/* 항목들이 차지한 바이트 수 (헤더 포함) */
+static uint8_t *cbuf;			/* 압축 결과를 잠시 담는 페이지 */
+static uint8_t *wbuf;			/* writeback할 때 압축을 푸는 페이지 */
+static struct lock zswap_lock;
+
+/* 통계. */
+static long long stored_cnt;	/* 캐시에 넣은 페이지 수 */
+static long long rejected_cnt;	/* 잘 압축되지 않거나 자리가 없어 디스크로 보낸 페이지 수 */
+static long long hit_cnt;		/* 디스크 대신 캐시에서 읽어 온 페이지 수 */
+static long long writeback_cnt;	/* 캐시에서 디스크로 옮긴 페이지 수 */
+static long long orig_bytes;	/* 넣은 페이지의 원래 크기 합 */
+static long long comp_bytes;	/* 넣은 페이지의 압축된 크기 합 */
+
+void
+zswap_init (struct disk *disk, size_t slot_cnt, size_t user_pages) {
+	swap_disk = disk;
+	if (zswap_limit == SIZE_MAX)
+		zswap_limit = user_pages * PGSIZE / 8;
+	list_init (&lru);
+	lock_init (&zswap_lock);
+	if (zswap_limit == 0 || slot_cnt == 0)
+		return;
+
+	zslot = calloc (slot_cnt, sizeof *zslot);
+	cbuf = palloc_get_page (0);
+	wbuf = palloc_get_page (0);
+	if (zslot == NULL || cbuf == NULL || wbuf == NULL)
+		PANIC ("zswap: out of memory");
+}
+
+static void
+entry_remove (struct zentry *e) {
+	list_remove (&e->lru_elem);
+	zslot[e->slot] = NULL;
+	used -= sizeof *e + e->size;
+	free (e);
+}
+
+/* 가장 오래된 항목을 디스크의 제 슬롯에 써 주고 캐시에서 뺀다. */
+static void
+writeback_oldest (void) {
+	struct zentry *e = list_entry (list_front (&lru), struct zentry, lru_elem);
+	const size_t sectors = PGSIZE / DISK_SECTOR_SIZE;
+
+	if (lzf_decompress (e->data, e->size, wbuf, PGSIZE) != PGSIZE)
+		PANIC ("zswap: corrupt entry for slot %d", e->slot);
+	for (size_t i = 0; i < sectors; i++)
+		disk_write (swap_disk, e->slot * sectors + i, wbuf + DISK_SECTOR_SIZE * i);
+	entry_remove (e);
+	writeback_cnt++;
+}
+
+/* KVA의 한 페이지를 SLOT의 내용으로 압축해 넣는다.
+   캐시를 끄고 있거나, 잘 압축되지 않거나, 자리를 만들 수 없으면 false이고
+   그러면 호출한 쪽이 디스크에 써야 한다. */
+bool
+zswap_store (int slot, const void *kva) {
+	struct zentry *e = NULL;
+	size_t size, need;
+
+	if (zslot == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	size = lzf_compress (kva, PGSIZE, cbuf, ZSWAP_MAX_SIZE);
+	need = sizeof *e + size;
+	if (size != 0 && need <= zswap_limit) {
+		while (used + need > zswap_limit && !list_empty (&lru))
+			writeback_oldest ();
+		e = malloc (need);
+	}
+	if (e == NULL) {
+		rejected_cnt++;
+		lock_release (&zswap_lock);
+		return false;
+	}
+
+	e->slot = slot;
+	e->size = size;
+	memcpy (e->data, cbuf, size);
+	list_push_back (&lru, &e->lru_elem);
+	zslot[slot] = e;
+	used += need;
+	stored_cnt++;
+	orig_bytes += PGSIZE;
+	comp_bytes += size;
+	lock_release (&zswap_lock);
+	return true;
+}
+
+/* SLOT의 내용이 캐시에 있으면 KVA에 풀어 주고 true.
+   없으면(디스크에 있으면) false. */
+bool
+zswap_load (int slot, void *kva) {
+	struct zentry *e;
+
+	if (zslot == NULL)
+		return false;
+
+	lock_acquire (&zswap_lock);
+	e = zslot[slot];
+	if (e != NULL) {
+		if (lzf_decompress (e->data, e->size, kva, PGSIZE) != PGSIZE)
+			PANIC ("zswap: corrupt entry for slot %d", slot);
+		hit_cnt++;
+	}
+	lock_release (&zswap_lock);
+	return e != NULL;
+}
+
+/* SLOT이 비워졌다. 캐시에 남은 항목이 있으면 버린다. */
+void
+zswap_invalidate (int slot) {
+	if (zslot == NULL)
+		return;
+
+	lock_acquire (&zswap_lock);
+	if (zslot[slot] != NULL)
+		entry_remove (zslot[slot]);
+	lock_release (&zswap_lock);
+}
+
+/* Prints compressed swap statistics. */
+void
+zswap_print_stats (void) {
+	long long ratio = comp_bytes > 0 ? orig_bytes * 100 / comp_bytes : 0;
+
+	printf ("Zswap: %lld stored, %lld rejected, %lld hits, %lld writebacks, "
+			"ratio %lld.%02lld, %zu of %zu kB used\n",
+			stored_cnt, rejected_cnt, hit_cnt, writeback_cnt,
+			ratio / 100, ratio % 100, used / 1024, zswap_limit / 1024);
+}